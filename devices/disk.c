@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/workqueue.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -72,6 +73,7 @@ struct channel {
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+	struct work unexpected_work;        /* Reports spurious interrupts. */
 
 	struct disk devices[2];     /* The devices on this channel. */
 };
@@ -95,6 +97,7 @@ static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static work_func report_unexpected;
 
 /* Initialize the disk subsystem and detect disks. */
 void
@@ -120,8 +123,10 @@ disk_init (void) {
 				NOT_REACHED ();
 		}
 		lock_init (&c->lock);
+		lock_set_name (&c->lock, "disk channel");
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
+		work_init (&c->unexpected_work, report_unexpected, c, WORK_LOW);
 
 		/* Initialize devices. */
 		for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -522,13 +527,21 @@ interrupt_handler (struct intr_frame *f) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
 				sema_up (&c->completion_wait);      /* Wake up waiter. */
 			} else
-				printf ("%s: unexpected interrupt\n", c->name);
+				work_schedule (&c->unexpected_work);
 			return;
 		}
 
 	NOT_REACHED ();
 }
 
+/* Reports an unexpected interrupt on channel C_.  Printing is too
+   slow to do in the interrupt handler itself. */
+static void
+report_unexpected (void *c_) {
+	struct channel *c = c_;
+	printf ("%s: unexpected interrupt\n", c->name);
+}
+
 static void
 inspect_read_cnt (struct intr_frame *f) {
 	struct disk * d = disk_get (f->R.rdx, f->R.rcx);
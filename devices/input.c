@@ -2,14 +2,33 @@
 #include <debug.h>
 #include "devices/intq.h"
 #include "devices/serial.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
+
+/* Ctrl-T, which dumps the scheduler trace. */
+#define CTRL_T 0x14
 
 /* Stores keys from the keyboard and serial port. */
 static struct intq buffer;
 
+#ifdef SCHED_TRACE
+/* Dumps the scheduler trace.  Printing it takes far too long to
+   do from the keyboard or serial interrupt. */
+static struct work trace_dump_work;
+
+static void
+trace_dump_func (void *aux UNUSED) {
+	trace_dump ();
+}
+#endif
+
 /* Initializes the input buffer. */
 void
 input_init (void) {
 	intq_init (&buffer);
+#ifdef SCHED_TRACE
+	work_init (&trace_dump_work, trace_dump_func, NULL, WORK_LOW);
+#endif
 }
 
 /* Adds a key to the input buffer.
@@ -19,6 +38,12 @@ input_putc (uint8_t key) {
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (!intq_full (&buffer));
 
+#ifdef SCHED_TRACE
+	if (key == CTRL_T && trace_enabled) {
+		work_schedule (&trace_dump_work);
+		return;
+	}
+#endif
 	intq_putc (&buffer, key);
 	serial_notify ();
 }
@@ -6,6 +6,7 @@
 #include "devices/input.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/workqueue.h"
 
 /* Keyboard data register port. */
 #define DATA_REG 0x60
@@ -23,11 +24,24 @@ static bool caps_lock;
 /* Number of keys pressed. */
 static int64_t key_cnt;
 
+/* Scancodes read by the interrupt handler and not yet translated.
+   The handler only advances HEAD and translate_work only advances
+   TAIL, so neither needs a lock. */
+#define SCANCODE_CNT 64
+static unsigned scancodes[SCANCODE_CNT];
+static unsigned scancode_head, scancode_tail;
+
+/* Translates the pending scancodes into keys. */
+static struct work translate_work;
+
 static intr_handler_func keyboard_interrupt;
+static work_func translate_scancodes;
+static void translate_scancode (unsigned code);
 
 /* Initializes the keyboard. */
 void
 kbd_init (void) {
+	work_init (&translate_work, translate_scancodes, NULL, WORK_DEFAULT);
 	intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -84,27 +98,56 @@ static const struct keymap shifted_keymap[] = {
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
 
+/* Reads the scancode out of the keyboard controller and leaves
+   its translation to translate_work. */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) {
+	/* Keyboard scancode. */
+	unsigned code;
+	unsigned head = scancode_head;
+
+	/* Read scancode, including second byte if prefix code. */
+	code = inb (DATA_REG);
+	if (code == 0xe0)
+		code = (code << 8) | inb (DATA_REG);
+
+	/* If the queue is full, drop the key, as if the input buffer
+	   were full. */
+	if (head - __atomic_load_n (&scancode_tail, __ATOMIC_ACQUIRE)
+			< SCANCODE_CNT) {
+		scancodes[head % SCANCODE_CNT] = code;
+		__atomic_store_n (&scancode_head, head + 1, __ATOMIC_RELEASE);
+	}
+	work_schedule (&translate_work);
+}
+
+/* Translates every scancode queued by keyboard_interrupt(). */
+static void
+translate_scancodes (void *aux UNUSED) {
+	unsigned tail = scancode_tail;
+
+	while (tail != __atomic_load_n (&scancode_head, __ATOMIC_ACQUIRE)) {
+		unsigned code = scancodes[tail % SCANCODE_CNT];
+		__atomic_store_n (&scancode_tail, ++tail, __ATOMIC_RELEASE);
+		translate_scancode (code);
+	}
+}
+
+/* Updates the shift state for scancode CODE, or appends the
+   character it stands for to the input buffer. */
+static void
+translate_scancode (unsigned code) {
 	/* Status of shift keys. */
 	bool shift = left_shift || right_shift;
 	bool alt = left_alt || right_alt;
 	bool ctrl = left_ctrl || right_ctrl;
 
-	/* Keyboard scancode. */
-	unsigned code;
-
 	/* False if key pressed, true if key released. */
 	bool release;
 
 	/* Character that corresponds to `code'. */
 	uint8_t c;
 
-	/* Read scancode, including second byte if prefix code. */
-	code = inb (DATA_REG);
-	if (code == 0xe0)
-		code = (code << 8) | inb (DATA_REG);
-
 	/* Bit 0x80 distinguishes key press from key release
 	   (even if there's a prefix). */
 	release = (code & 0x80) != 0;
@@ -135,10 +178,12 @@ keyboard_interrupt (struct intr_frame *args UNUSED) {
 				c += 0x80;
 
 			/* Append to keyboard buffer. */
+			enum intr_level old_level = intr_disable ();
 			if (!input_full ()) {
 				key_cnt++;
 				input_putc (c);
 			}
+			intr_set_level (old_level);
 		}
 	} else {
 		/* Maps a keycode into a shift state variable. */
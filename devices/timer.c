@@ -7,6 +7,8 @@
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -20,21 +22,111 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Number of loops per timer tick.
-   Initialized by timer_calibrate(). */
-static unsigned loops_per_tick;
+/* Nanoseconds per timer tick. */
+#define NSEC_PER_TICK ((int64_t) (NSEC_PER_SEC / TIMER_FREQ))
+
+/* Time-stamp counter clocksource, set up by timer_calibrate().
+   timer_ns() is BASE_NS plus the cycles since BASE_TSC, times
+   TSC_MULT / 2**32.  TSC_MULT is 0 until calibrated. */
+static uint64_t tsc_hz;
+static uint64_t tsc_mult;
+static uint64_t base_tsc;
+static int64_t base_ns;
+
+/* Number of timer ticks to count TSC cycles over. */
+#define CALIBRATE_TICKS 10
+
+/* 8254 input frequency, and the number of its cycles per timer
+   tick, rounded to nearest. */
+#define PIT_HZ 1193180
+#define PIT_COUNT_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Longest one-shot interval the 16-bit counter can express. */
+#define ONESHOT_MAX_TICKS (0xffff / PIT_COUNT_PER_TICK)
+
+/* If true, stop the periodic tick while the CPU is idle.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* Number of tick boundaries the one-shot interval currently
+   programmed covers, the last at its expiry, or 0 if the timer is
+   in periodic mode.  The boundaries are PIT_COUNT_PER_TICK counts
+   apart. */
+static int64_t oneshot_ticks;
+
+/* If nonzero, the one-shot interval currently programmed ends
+   this many PIT counts short of the next tick boundary, to wake a
+   precise sleeper, and covers no boundary at all. */
+static uint16_t oneshot_rest;
+
+/* Count last written to the PIT, returned by pit_read_count()
+   until the counter has loaded it. */
+static uint16_t pit_count;
+
+/* Threads in real_time_sleep() waiting out less than a tick, in
+   order of deadline.  The first is woken by a one-shot interval
+   that ends between tick boundaries. */
+struct precise_sleeper {
+	struct thread *t;
+	int64_t deadline;                   /* timer_ns() to wake at. */
+	struct list_elem elem;
+};
+static struct list precise_sleepers;
+
+/* A precise sleeper is woken this many nanoseconds before its
+   deadline, at most, and spins for the rest, which covers the
+   interrupt and context switch latency. */
+#define PRECISE_SPIN_NS 50000
+
+/* Tickless statistics. */
+static int64_t idle_periods;    /* # of one-shot intervals programmed. */
+static int64_t skipped_ticks;   /* # of ticks without an interrupt. */
+
+/* Slack statistics. */
+static int64_t slack_sleeps;    /* # of sleeps allowed to wake late. */
+static int64_t coalesced_wakeups; /* # of those that shared a tick. */
 
 static intr_handler_func timer_interrupt;
-static bool too_many_loops (unsigned loops);
-static void busy_wait (int64_t loops);
-static void real_time_sleep (int64_t num, int32_t denom);
-
-/* Add */
-static struct list sleep_list;
-static struct lock memory_lock;
-
-void check_wakeup_thread();
-bool wakeup_tick_less(const struct list_elem *a, const struct list_elem *b, void *aux);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (uint16_t count, int64_t ticks);
+static uint16_t pit_read_count (bool *expired);
+static void timer_advance (int64_t cnt);
+static void real_time_sleep (int64_t ns);
+static bool precise_less (const struct list_elem *,
+		const struct list_elem *, void *);
+static void precise_arm (void);
+static void precise_wake (void);
+
+/* Sleeping threads are kept in a hierarchical timing wheel.
+   Level 0 has one slot per tick for the next WHEEL_SIZE ticks;
+   each slot of level N covers WHEEL_SIZE times as many ticks as
+   a slot of level N - 1.  Inserting a sleeper is O(1): it goes
+   into the slot of the coarsest level that still resolves its
+   deadline.  Whenever level N - 1 wraps around, the next slot of
+   level N is cascaded, i.e. its sleepers are redistributed into
+   finer levels, so every sleeper reaches level 0 exactly in the
+   tick it expires. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+
+/* Largest deadline distance the wheel resolves directly.
+   Sleepers further out park in the top level and are
+   re-inserted as they cascade. */
+#define WHEEL_MAX_DELTA ((1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Next tick the wheel will process.  Always ticks + 1 outside
+   the timer interrupt. */
+static int64_t wheel_ticks;
+
+static void wheel_insert (struct sleeping_thread *);
+static int64_t wheel_pick_tick (int64_t first, int64_t last);
+static void wheel_cascade (int level);
+static int64_t wheel_next_expiry (int64_t limit);
+static void wheel_advance (bool preempt);
 void print_sleep_list(void);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
@@ -42,54 +134,83 @@ void print_sleep_list(void);
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+	int level, slot;
 
-	list_init(&sleep_list);
+	for (level = 0; level < WHEEL_LEVELS; level++)
+		for (slot = 0; slot < WHEEL_SIZE; slot++)
+			list_init (&wheel[level][slot]);
+	wheel_ticks = ticks + 1;
+	list_init (&precise_sleepers);
 
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
+	pit_set_periodic ();
 
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates the time-stamp counter against the PIT, by counting
+   its cycles over CALIBRATE_TICKS timer ticks, and switches
+   timer_ns() over to it. */
 void
 timer_calibrate (void) {
-	unsigned high_bit, test_bit;
+	int64_t start;
+	uint64_t tsc;
 
 	ASSERT (intr_get_level () == INTR_ON);
 	printf ("Calibrating timer...  ");
 
-	/* Approximate loops_per_tick as the largest power-of-two
-	   still less than one timer tick. */
-	loops_per_tick = 1u << 10;
-	while (!too_many_loops (loops_per_tick << 1)) {
-		loops_per_tick <<= 1;
-		ASSERT (loops_per_tick != 0);
-	}
+	/* Start and end on a tick boundary. */
+	start = timer_ticks ();
+	while (timer_ticks () == start)
+		barrier ();
+	start++;
+	tsc = rdtsc ();
+	while (timer_ticks () < start + CALIBRATE_TICKS)
+		barrier ();
+	base_tsc = rdtsc ();
+	base_ns = (start + CALIBRATE_TICKS) * NSEC_PER_TICK;
+	tsc_hz = (base_tsc - tsc) * TIMER_FREQ / CALIBRATE_TICKS;
+	ASSERT (tsc_hz > 0);
 
-	/* Refine the next 8 bits of loops_per_tick. */
-	high_bit = loops_per_tick;
-	for (test_bit = high_bit >> 1; test_bit != high_bit >> 10; test_bit >>= 1)
-		if (!too_many_loops (high_bit | test_bit))
-			loops_per_tick |= test_bit;
+	/* Publish the multiplier last: readers that see it see the
+	   base too. */
+	barrier ();
+	tsc_mult = (NSEC_PER_SEC << 32) / tsc_hz;
 
-	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+	printf ("%'"PRIu64" TSC cycles/s.\n", tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) {
-	enum intr_level old_level = intr_disable ();
-	int64_t t = ticks;
-	intr_set_level (old_level);
+	/* Aligned 64-bit loads are atomic, so there is no need to turn
+	   off the timer interrupt that updates TICKS. */
+	int64_t t = __atomic_load_n (&ticks, __ATOMIC_RELAXED);
 	barrier ();
 	return t;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  Once
+   the time-stamp counter is calibrated this is precise and never
+   takes a lock or turns off interrupts; before then it only
+   advances with each timer tick. */
+int64_t
+timer_ns (void) {
+	uint64_t mult = tsc_mult;
+
+	barrier ();
+	if (mult == 0)
+		return timer_ticks () * NSEC_PER_TICK;
+	return base_ns + (int64_t)
+		(((unsigned __int128) (rdtsc () - base_tsc) * mult) >> 32);
+}
+
+/* Converts CYCLES of the time-stamp counter into nanoseconds.
+   Returns 0 before the counter is calibrated. */
+int64_t
+timer_cycles_to_ns (uint64_t cycles) {
+	return ((unsigned __int128) cycles * tsc_mult) >> 32;
+}
+
 /* Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -97,154 +218,526 @@ timer_elapsed (int64_t then) {
 	return timer_ticks () - then;
 }
 
-/* Suspends execution for approximately TICKS timer ticks. */
+/* Suspends execution for approximately TICKS timer ticks, or up
+   to the running thread's default slack longer; see
+   timer_sleep_slack(). */
 void
 timer_sleep (int64_t ticks) {
+	timer_sleep_slack (ticks, thread_current ()->timer_slack);
+}
+
+/* Suspends execution for approximately TICKS timer ticks, but
+   allows the wakeup to come up to SLACK ticks later, so that it
+   can share a tick with other sleepers.  Each timer interrupt
+   that wakes sleepers does so in one pass, with one preemption
+   check, so the fewer such ticks the better. */
+void
+timer_sleep_slack (int64_t ticks, int64_t slack) {
 	struct sleeping_thread st;
-	
+	int64_t deadline;
+
 	st.t = thread_current();
-	st.wakeup_ticks = timer_ticks() + ticks;
+	deadline = timer_ticks() + ticks;
 
 	enum intr_level old_level = intr_disable();
-	list_insert_ordered(&sleep_list, &st.elem, wakeup_tick_less, NULL);
+	st.wakeup_ticks = deadline;
+	st.slacked = false;
+	if (slack > 0) {
+		st.wakeup_ticks = wheel_pick_tick (deadline, deadline + slack);
+		st.slacked = st.wakeup_ticks != deadline;
+		slack_sleeps++;
+	}
+	TRACE (TRACE_SLEEP, st.t->tid, 0, st.wakeup_ticks);
+	wheel_insert (&st);
 
 	thread_block();
 	intr_set_level(old_level);
 }
 
+/* Sets the running thread's default slack for timer_sleep() to
+   SLACK ticks.  Threads it creates inherit it. */
+void
+timer_set_slack (int64_t slack) {
+	ASSERT (slack >= 0);
+	thread_current ()->timer_slack = slack;
+}
+
+/* Returns the running thread's default timer_sleep() slack. */
+int64_t
+timer_get_slack (void) {
+	return thread_current ()->timer_slack;
+}
+
 /* Suspends execution for approximately MS milliseconds. */
 void
 timer_msleep (int64_t ms) {
-	real_time_sleep (ms, 1000);
+	real_time_sleep (ms * 1000 * 1000);
 }
 
 /* Suspends execution for approximately US microseconds. */
 void
 timer_usleep (int64_t us) {
-	real_time_sleep (us, 1000 * 1000);
+	real_time_sleep (us * 1000);
 }
 
 /* Suspends execution for approximately NS nanoseconds. */
 void
 timer_nsleep (int64_t ns) {
-	real_time_sleep (ns, 1000 * 1000 * 1000);
+	real_time_sleep (ns);
 }
 
 /* Prints timer statistics. */
 void
 timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	if (timer_tickless)
+		printf ("Timer: %"PRId64" idle periods, %"PRId64" ticks skipped\n",
+				idle_periods, skipped_ticks);
+	if (slack_sleeps > 0)
+		printf ("Timer: %"PRId64" of %"PRId64" slack sleeps coalesced\n",
+				coalesced_wakeups, slack_sleeps);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick by a
+   single interrupt at the nearest deadline: the next sleeper to
+   wake up or, under the MLFQS, the next once-per-second
+   recomputation.  The idle thread has no time slice to
+   enforce. */
+void
+timer_idle_enter (void) {
+	int64_t limit, expiry;
+	uint16_t count;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!timer_tickless || oneshot_ticks != 0 || oneshot_rest != 0)
+		return;
+
+	limit = ticks + ONESHOT_MAX_TICKS;
+	if (thread_mlfqs && limit > ticks + TIMER_FREQ - ticks % TIMER_FREQ)
+		limit = ticks + TIMER_FREQ - ticks % TIMER_FREQ;
+	if (!list_empty (&precise_sleepers)) {
+		/* Wake up in the tick before the first precise sleeper's,
+		   which arms its sub-tick interval. */
+		struct precise_sleeper *ps = list_entry (
+				list_front (&precise_sleepers), struct precise_sleeper, elem);
+		if (limit > ps->deadline / NSEC_PER_TICK - 1)
+			limit = ps->deadline / NSEC_PER_TICK - 1;
+	}
+	expiry = wheel_next_expiry (limit);
+
+	/* Not worth it for a deadline at the very next tick. */
+	if (expiry - ticks <= 1)
+		return;
+
+	/* The current tick is partly over: the first boundary is
+	   where the periodic count would have reached it. */
+	count = pit_read_count (NULL);
+	if (count == 0 || count > PIT_COUNT_PER_TICK)
+		count = PIT_COUNT_PER_TICK;
+	pit_set_oneshot (count + (expiry - ticks - 1) * PIT_COUNT_PER_TICK,
+			expiry - ticks);
+	idle_periods++;
+}
+
+/* Called by the scheduler, with interrupts off, when the idle
+   thread stops running.  If a one-shot interval is pending,
+   accounts for the ticks that passed while it was pending.  The
+   tick in progress is finished by a one-shot interval of just
+   the counts left in it, whose interrupt restores the periodic
+   tick, so that no partial tick is lost. */
+void
+timer_idle_exit (void) {
+	uint16_t count;
+	int64_t elapsed, left;
+	bool expired;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Nothing to do in periodic mode, nor for a sub-tick interval,
+	   which covers no boundary. */
+	if (oneshot_ticks == 0)
+		return;
+
+	count = pit_read_count (&expired);
+	if (expired) {
+		/* Terminal count was reached and the interrupt is
+		   pending.  It will account for the final tick once it is
+		   delivered. */
+		elapsed = oneshot_ticks - 1;
+		oneshot_ticks = 1;
+	} else {
+		/* Boundaries are at counts 0, PIT_COUNT_PER_TICK, ...;
+		   those at or above COUNT have passed. */
+		left = DIV_ROUND_UP (count, PIT_COUNT_PER_TICK);
+		elapsed = oneshot_ticks - left;
+		if (left > 1)
+			pit_set_oneshot ((count - 1) % PIT_COUNT_PER_TICK + 1, 1);
+		oneshot_ticks = 1;
+	}
+
+	timer_advance (elapsed);
+	wheel_advance (false);
+	thread_account_idle (elapsed);
+	skipped_ticks += elapsed;
 }
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
-	if(thread_mlfqs){
-		mlfqs_incr(); // 현재 쓰레드의 recent_cpu +1
-		if (ticks % 4 == 0) {
-			mlfqs_recalculate_priority();
-			if (ticks % TIMER_FREQ == 0) {
-				mlfqs_load_avg();
-				mlfqs_recalculate_recent_cpu();
+timer_interrupt (struct intr_frame *args) {
+	int64_t elapsed = 1;
+
+	if (oneshot_rest != 0) {
+		/* A precise sleeper's sub-tick interval expired: finish the
+		   tick it cut short, then wake the sleeper.  No tick has
+		   passed. */
+		pit_set_oneshot (oneshot_rest, 1);
+		precise_wake ();
+		return;
+	}
+
+	if (oneshot_ticks != 0) {
+		/* The idle one-shot interval expired: catch up on every
+		   tick it covered. */
+		elapsed = oneshot_ticks;
+		oneshot_ticks = 0;
+		pit_set_periodic ();
+		thread_account_idle (elapsed - 1);
+		skipped_ticks += elapsed - 1;
+	}
+
+	timer_advance (elapsed);
+	wheel_advance (true);
+	precise_wake ();
+	thread_tick ((args->cs & 3) == 3);
+}
+
+/* Advances the tick count by CNT, doing the per-tick scheduler
+   bookkeeping for each tick. */
+static void
+timer_advance (int64_t cnt) {
+	while (cnt-- > 0) {
+		ticks++;
+		if(thread_mlfqs){
+			mlfqs_incr(); // 현재 쓰레드의 recent_cpu +1
+			if (ticks % 4 == 0) {
+				mlfqs_recalculate_priority();
+				if (ticks % TIMER_FREQ == 0) {
+					mlfqs_load_avg();
+					mlfqs_recalculate_recent_cpu();
+				}
 			}
 		}
 	}
-	check_wakeup_thread();	// 깨워야 할 스레드 체크
-	thread_tick ();
 }
 
-/* Returns true if LOOPS iterations waits for more than one timer
-   tick, otherwise false. */
-static bool
-too_many_loops (unsigned loops) {
-	/* Wait for a timer tick. */
-	int64_t start = ticks;
-	while (ticks == start)
-		barrier ();
-
-	/* Run LOOPS loops. */
-	start = ticks;
-	busy_wait (loops);
+/* Sets up the 8254 Programmable Interval Timer (PIT) to
+   interrupt TIMER_FREQ times per second. */
+static void
+pit_set_periodic (void) {
+	uint16_t count = PIT_COUNT_PER_TICK;
 
-	/* If the tick count changed, we iterated too long. */
-	barrier ();
-	return start != ticks;
+	pit_count = count;
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
 }
 
-/* Iterates through a simple loop LOOPS times, for implementing
-   brief delays.
+/* Sets up the PIT to interrupt once, COUNT of its cycles from
+   now, and then stay quiet.  The interval covers TICKS tick
+   boundaries, the last at its expiry, or none if TICKS is 0; the
+   caller then sets ONESHOT_REST. */
+static void
+pit_set_oneshot (uint16_t count, int64_t ticks_) {
+	ASSERT (ticks_ >= 0 && ticks_ <= ONESHOT_MAX_TICKS);
+	ASSERT (count > 0);
+
+	oneshot_ticks = ticks_;
+	oneshot_rest = 0;
+	pit_count = count;
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
 
-   Marked NO_INLINE because code alignment can significantly
-   affect timings, so that if this function was inlined
-   differently in different places the results would be difficult
-   to predict. */
-static void NO_INLINE
-busy_wait (int64_t loops) {
-	while (loops-- > 0)
-		barrier ();
+/* Returns the PIT cycles left before counter 0 next interrupts.
+   If EXPIRED is nonnull, sets it to whether a one-shot interval
+   has already reached terminal count.  A count just written may
+   not have been loaded yet, in which case it is returned as
+   is. */
+static uint16_t
+pit_read_count (bool *expired) {
+	uint8_t status, lo, hi;
+
+	/* Read-back command: latch status and count of counter 0. */
+	outb (0x43, 0xc2);
+	status = inb (0x40);
+	lo = inb (0x40);
+	hi = inb (0x40);
+	if (status & 0x40) {
+		/* Null count: the new count is not loaded yet. */
+		if (expired != NULL)
+			*expired = false;
+		return pit_count;
+	}
+	if (expired != NULL)
+		*expired = (status & 0x80) != 0;
+	return lo | (hi << 8);
 }
 
-/* Sleep for approximately NUM/DENOM seconds. */
+/* Sleeps for approximately NS nanoseconds. */
 static void
-real_time_sleep (int64_t num, int32_t denom) {
-	/* Convert NUM/DENOM seconds into timer ticks, rounding down.
-
-	   (NUM / DENOM) s
-	   ---------------------- = NUM * TIMER_FREQ / DENOM ticks.
-	   1 s / TIMER_FREQ ticks
-	   */
-	int64_t ticks = num * TIMER_FREQ / denom;
+real_time_sleep (int64_t ns) {
+	int64_t end = timer_ns () + ns;
+	int64_t ticks = ns / NSEC_PER_TICK;
 
 	ASSERT (intr_get_level () == INTR_ON);
-	if (ticks > 0) {
-		/* We're waiting for at least one full timer tick.  Use
-		   timer_sleep() because it will yield the CPU to other 
-		   processes. */
-		timer_sleep (ticks);
-	} else {
-		/* Otherwise, use a busy-wait loop for more accurate
-		   sub-tick timing.  We scale the numerator and denominator
-		   down by 1000 to avoid the possibility of overflow. */
-		ASSERT (denom % 1000 == 0);
-		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
+
+	/* Block for the whole ticks, less one, because the first one
+	   may be nearly over already. */
+	if (ticks > 1)
+		timer_sleep (ticks - 1);
+
+	/* Before calibration, timer_ns() only moves with the tick, so
+	   there is nothing finer to wait for. */
+	if (tsc_mult == 0) {
+		while (timer_ns () < end)
+			timer_sleep (1);
+		return;
+	}
+
+	/* Block for the rest too, until a sub-tick interval wakes us
+	   just short of END, unless that is too close to bother. */
+	if (end - timer_ns () > PRECISE_SPIN_NS) {
+		struct precise_sleeper ps;
+		enum intr_level old_level;
+
+		ps.t = thread_current ();
+		ps.deadline = end;
+		old_level = intr_disable ();
+		list_insert_ordered (&precise_sleepers, &ps.elem, precise_less, NULL);
+		precise_arm ();
+		thread_block ();
+		intr_set_level (old_level);
 	}
+
+	/* Spin out the last few microseconds, letting other threads
+	   run meanwhile if any are ready. */
+	while (timer_ns () < end)
+		thread_yield ();
+}
+
+/* Orders precise sleepers by deadline. */
+static bool
+precise_less (const struct list_elem *a, const struct list_elem *b,
+		void *aux UNUSED) {
+	return list_entry (a, struct precise_sleeper, elem)->deadline
+		< list_entry (b, struct precise_sleeper, elem)->deadline;
+}
+
+/* Programs a sub-tick one-shot interval to wake the first
+   precise sleeper, if it is due before the next tick boundary.
+   Otherwise that boundary's interrupt arms it later.  The
+   interval ends ONESHOT_REST counts short of the boundary, which
+   its interrupt then finishes, so the tick keeps its phase.
+   Interrupts must be off. */
+static void
+precise_arm (void) {
+	struct precise_sleeper *ps;
+	int64_t delta;
+	int boundary;
+	uint16_t count;
+	bool expired;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (list_empty (&precise_sleepers))
+		return;
+	ps = list_entry (list_front (&precise_sleepers),
+			struct precise_sleeper, elem);
+
+	/* PIT counts until the next tick boundary. */
+	count = pit_read_count (&expired);
+	if (oneshot_ticks == 0 && oneshot_rest == 0)
+		boundary = count;
+	else if (expired)
+		return;   /* Its interrupt will arm us. */
+	else if (oneshot_rest != 0)
+		boundary = count + oneshot_rest;
+	else
+		boundary = (count - 1) % PIT_COUNT_PER_TICK + 1;
+
+	delta = (ps->deadline - PRECISE_SPIN_NS / 2 - timer_ns ())
+		* PIT_HZ / (int64_t) NSEC_PER_SEC;
+	if (delta >= boundary)
+		return;
+	if (delta < 1)
+		delta = 1;
+	pit_set_oneshot (delta, 0);
+	oneshot_rest = boundary - delta;
 }
 
-void check_wakeup_thread() {
-    struct list_elem *e = list_begin(&sleep_list);
-	int64_t now_ticks = timer_ticks();
+/* Wakes the precise sleepers within PRECISE_SPIN_NS of their
+   deadlines, and arms the interval for the next one.  Called by
+   the timer interrupt. */
+static void
+precise_wake (void) {
+	int64_t now = timer_ns ();
+	bool woken = false;
+
+	while (!list_empty (&precise_sleepers)) {
+		struct precise_sleeper *ps = list_entry (
+				list_front (&precise_sleepers), struct precise_sleeper, elem);
+		if (ps->deadline - PRECISE_SPIN_NS > now)
+			break;
+		list_pop_front (&precise_sleepers);
+		thread_unblock (ps->t);
+		woken = true;
+	}
+	precise_arm ();
 
+	if (woken)
+		check_priority ();
+}
 
-	while (e != list_end(&sleep_list)) {
-		struct sleeping_thread *st = list_entry(e, struct sleeping_thread, elem);
+/* Puts ST into the wheel slot that expires at its wakeup tick,
+   or into the coarsest slot that will be cascaded before then.
+   Interrupts must be off. */
+static void
+wheel_insert (struct sleeping_thread *st) {
+	int64_t expires = st->wakeup_ticks;
+	int64_t delta;
+	int level;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	/* Deadlines already past are woken at the next tick. */
+	if (expires < wheel_ticks)
+		expires = wheel_ticks;
+	delta = expires - wheel_ticks;
+	if (delta > WHEEL_MAX_DELTA) {
+		delta = WHEEL_MAX_DELTA;
+		expires = wheel_ticks + delta;
+	}
 
-		if (st->wakeup_ticks <= now_ticks) {
-			e = list_remove(e);
-			thread_unblock(st->t);
-			check_priority();
-		} else {
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < 1LL << (WHEEL_BITS * (level + 1)))
 			break;
-		}
+
+	list_push_back (&wheel[level][(expires >> (WHEEL_BITS * level)) & WHEEL_MASK],
+			&st->elem);
+}
+
+/* Returns the tick between FIRST and LAST, inclusive, at which to
+   wake a sleeper that allows that much slack: the first at which
+   some other sleeper already wakes up, if any does within the
+   range of level 0, or else the tick with the most trailing zero
+   bits, so that independent sleepers gravitate to the same
+   ticks.  Interrupts must be off. */
+static int64_t
+wheel_pick_tick (int64_t first, int64_t last) {
+	int64_t t;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (first <= last);
+
+	if (first < wheel_ticks)
+		first = wheel_ticks;
+	if (last < first)
+		return first;
+
+	for (t = first; t <= last && t - wheel_ticks < WHEEL_SIZE; t++)
+		if (!list_empty (&wheel[0][t & WHEEL_MASK]))
+			return t;
+
+	/* FIRST and LAST agree above their highest differing bit, in
+	   which LAST has a 1; clearing the bits below it in LAST gives
+	   the roundest tick in between. */
+	if (first == last)
+		return first;
+	return last & ~((1LL << (63 - __builtin_clzll (first ^ last))) - 1);
+}
+
+/* Returns the tick at which the next sleeper wakes up, or LIMIT
+   if that is later than LIMIT.  A tick at which the wheel
+   cascades also counts, because sleepers in coarser levels may
+   become due just after it. */
+static int64_t
+wheel_next_expiry (int64_t limit) {
+	int64_t t;
+
+	for (t = wheel_ticks; t < limit; t++) {
+		if (!list_empty (&wheel[0][t & WHEEL_MASK]))
+			return t;
+		if ((t & WHEEL_MASK) == 0)
+			return t;
 	}
+	return limit;
+}
+
+/* Moves every sleeper in the current slot of LEVEL into finer
+   levels. */
+static void
+wheel_cascade (int level) {
+	struct list *slot =
+		&wheel[level][(wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK];
+
+	while (!list_empty (slot))
+		wheel_insert (list_entry (list_pop_front (slot),
+					struct sleeping_thread, elem));
 }
 
-bool wakeup_tick_less(const struct list_elem *a, const struct list_elem *b, void *aux) {
-    const struct sleeping_thread *sleep_a = list_entry(a, struct sleeping_thread, elem);
-    const struct sleeping_thread *sleep_b = list_entry(b, struct sleeping_thread, elem);
-    return sleep_a->wakeup_ticks < sleep_b->wakeup_ticks;
+/* Advances the wheel up to the current tick, waking every thread
+   whose deadline has passed.  All expired sleepers of a tick are
+   unblocked in one pass, followed by a single preemption check if
+   PREEMPT is true. */
+static void
+wheel_advance (bool preempt) {
+	bool woken = false;
+	int batch, slacked;
+
+	while (wheel_ticks <= ticks) {
+		int idx = wheel_ticks & WHEEL_MASK;
+		struct list *slot = &wheel[0][idx];
+		int level;
+
+		/* Refill level 0 (and, in turn, each level that just
+		   wrapped) from the level above. */
+		for (level = 1; idx == 0 && level < WHEEL_LEVELS; level++) {
+			idx = (wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+			wheel_cascade (level);
+		}
+
+		batch = slacked = 0;
+		while (!list_empty (slot)) {
+			struct sleeping_thread *st =
+				list_entry (list_pop_front (slot), struct sleeping_thread, elem);
+			ASSERT (st->wakeup_ticks <= wheel_ticks);
+			TRACE (TRACE_TIMER_WAKE, st->t->tid, 0, wheel_ticks);
+			batch++;
+			slacked += st->slacked;
+			thread_unblock (st->t);
+			woken = true;
+		}
+		if (batch > 1)
+			coalesced_wakeups += slacked;
+		wheel_ticks++;
+	}
+
+	if (woken && preempt)
+		check_priority ();
 }
 
 void print_sleep_list(void) {
-    struct list_elem *e;
-
-    for (e = list_begin(&sleep_list); e != list_end(&sleep_list); e = list_next(e)) {
-        struct sleeping_thread *st = (st = list_entry(e, struct sleeping_thread, elem)) != NULL ? st : NULL;
-        if (st != NULL && st->t != NULL) {
-			printf("##################################### Thread: %d, Wakeup time: %" PRId64 "\n", st->t->tid, st->wakeup_ticks);
-		} else {
-			printf("Invalid thread or wakeup time.\n");
+	for (int level = 0; level < WHEEL_LEVELS; level++) {
+		for (int slot = 0; slot < WHEEL_SIZE; slot++) {
+			struct list *l = &wheel[level][slot];
+			for (struct list_elem *e = list_begin(l); e != list_end(l); e = list_next(e)) {
+				struct sleeping_thread *st = list_entry(e, struct sleeping_thread, elem);
+				printf("##################################### Thread: %d, Wakeup time: %" PRId64 ", Level: %d, Slot: %d\n", st->t->tid, st->wakeup_ticks, level, slot);
+			}
 		}
-    }
+	}
 	printf("----------------\n");
-}
\ No newline at end of file
+}
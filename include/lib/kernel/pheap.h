@@ -0,0 +1,63 @@
+#ifndef __LIB_KERNEL_PHEAP_H
+#define __LIB_KERNEL_PHEAP_H
+
+/* Pairing heap.
+ *
+ * A pairing heap is a self-adjusting heap-ordered multiway tree.
+ * Insertion and finding the maximum take O(1) time; removing the
+ * maximum, or any other element, takes O(log n) amortized time.
+ *
+ * Like the other kernel containers, the heap does not allocate
+ * memory.  Each structure that can be in a heap embeds a struct
+ * pheap_elem member, and pheap_entry converts a pointer to that
+ * member back into a pointer to the enclosing structure.  See
+ * lib/kernel/list.h for a detailed explanation of the technique.
+ *
+ * The heap is ordered by a caller-supplied less function; the
+ * element that compares greatest is at the root. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Heap element. */
+struct pheap_elem {
+	struct pheap_elem *child;   /* Leftmost child. */
+	struct pheap_elem *next;    /* Right sibling. */
+	struct pheap_elem *prev;    /* Left sibling, or parent if leftmost. */
+};
+
+/* Converts pointer to heap element PHEAP_ELEM into a pointer to
+ * the structure that PHEAP_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the heap element. */
+#define pheap_entry(PHEAP_ELEM, STRUCT, MEMBER)           \
+	((STRUCT *) ((uint8_t *) (PHEAP_ELEM)             \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two heap elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool pheap_less_func (const struct pheap_elem *a,
+		const struct pheap_elem *b,
+		void *aux);
+
+/* Pairing heap. */
+struct pheap {
+	struct pheap_elem *root;    /* Greatest element, or null. */
+	size_t size;                /* Number of elements. */
+	pheap_less_func *less;      /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void pheap_init (struct pheap *, pheap_less_func *, void *aux);
+void pheap_insert (struct pheap *, struct pheap_elem *);
+struct pheap_elem *pheap_max (const struct pheap *);
+struct pheap_elem *pheap_pop_max (struct pheap *);
+void pheap_remove (struct pheap *, struct pheap_elem *);
+void pheap_update (struct pheap *, struct pheap_elem *);
+
+size_t pheap_size (const struct pheap *);
+bool pheap_empty (const struct pheap *);
+
+#endif /* lib/kernel/pheap.h */
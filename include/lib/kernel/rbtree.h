@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/* Red-black tree.
+ *
+ * A red-black tree is a binary search tree kept balanced by
+ * coloring its nodes, so that no path from the root to a leaf is
+ * more than twice as long as any other.  Insertion and removal
+ * take O(log n) time.  The tree also caches its least element,
+ * so finding the minimum takes O(1) time.
+ *
+ * Like the other kernel containers, the tree does not allocate
+ * memory.  Each structure that can be in a tree embeds a struct
+ * rb_elem member, and rb_entry converts a pointer to that member
+ * back into a pointer to the enclosing structure.  See
+ * lib/kernel/list.h for a detailed explanation of the technique.
+ *
+ * The tree is ordered by a caller-supplied less function.
+ * Elements that compare equal are kept in insertion order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Tree element. */
+struct rb_elem {
+	struct rb_elem *parent;     /* Parent, or null at the root. */
+	struct rb_elem *left;       /* Lesser subtree. */
+	struct rb_elem *right;      /* Greater or equal subtree. */
+	bool red;                   /* Red or black? */
+};
+
+/* Converts pointer to tree element RB_ELEM into a pointer to the
+ * structure that RB_ELEM is embedded inside.  Supply the name of
+ * the outer structure STRUCT and the member name MEMBER of the
+ * tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)                 \
+	((STRUCT *) ((uint8_t *) (RB_ELEM)                \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Compares the value of two tree elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+		const struct rb_elem *b,
+		void *aux);
+
+/* Red-black tree. */
+struct rbtree {
+	struct rb_elem *root;       /* Root, or null if empty. */
+	struct rb_elem *min;        /* Least element, or null if empty. */
+	size_t size;                /* Number of elements. */
+	rb_less_func *less;         /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `less'. */
+};
+
+void rb_init (struct rbtree *, rb_less_func *, void *aux);
+void rb_insert (struct rbtree *, struct rb_elem *);
+void rb_remove (struct rbtree *, struct rb_elem *);
+struct rb_elem *rb_min (const struct rbtree *);
+struct rb_elem *rb_next (const struct rb_elem *);
+
+size_t rb_size (const struct rbtree *);
+bool rb_empty (const struct rbtree *);
+
+#endif /* lib/kernel/rbtree.h */
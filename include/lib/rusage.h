@@ -0,0 +1,34 @@
+#ifndef __LIB_RUSAGE_H
+#define __LIB_RUSAGE_H
+
+#include <stdint.h>
+
+/* Resource usage, as reported by the getrusage() system call.
+   Shared by the kernel and user programs. */
+
+/* getrusage() WHO argument. */
+#define RUSAGE_SELF 0           /* The calling thread. */
+#define RUSAGE_CHILDREN 1       /* Its children that were waited for. */
+
+/* Number of buckets in the wakeup latency histogram. */
+#define RUSAGE_LATENCY_CNT 32
+
+struct rusage {
+	/* Time in each state, in timer ticks.  Running time is sampled
+	   at each tick, the others are measured from state changes. */
+	int64_t ready_ticks;        /* Runnable, waiting for the CPU. */
+	int64_t kernel_ticks;       /* Running in the kernel. */
+	int64_t user_ticks;         /* Running user code. */
+	int64_t blocked_ticks;      /* Blocked. */
+
+	/* Scheduling events. */
+	int64_t wakeups;            /* # of times woken, or created. */
+	int64_t switches;           /* # of times scheduled in. */
+
+	/* Wakeup-to-run latency.  Bucket I counts wakeups that took
+	   from 2**I to 2**(I+1) - 1 time-stamp counter cycles to be
+	   scheduled; the last bucket also counts any longer ones. */
+	uint32_t latency[RUSAGE_LATENCY_CNT];
+};
+
+#endif /* lib/rusage.h */
@@ -36,6 +36,9 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	SYS_GETRUSAGE,              /* Report resource usage. */
+	SYS_CLOCK_GETTIME,          /* Read a clock. */
 };
 
 #endif /* lib/syscall-nr.h */
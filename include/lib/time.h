@@ -0,0 +1,17 @@
+#ifndef __LIB_TIME_H
+#define __LIB_TIME_H
+
+#include <stdint.h>
+
+/* Clocks for clock_gettime().  Shared by the kernel and user
+   programs. */
+typedef int clockid_t;
+#define CLOCK_MONOTONIC 1       /* Time since boot; never jumps. */
+
+/* A time, as seconds and nanoseconds. */
+struct timespec {
+	int64_t tv_sec;             /* Seconds. */
+	long tv_nsec;               /* Nanoseconds, 0 to 999,999,999. */
+};
+
+#endif /* lib/time.h */
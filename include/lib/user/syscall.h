@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <rusage.h>
+#include <time.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -37,6 +39,8 @@ unsigned tell (int fd);
 void close (int fd);
 
 int dup2(int oldfd, int newfd);
+int getrusage (int who, struct rusage *usage);
+int clock_gettime (clockid_t, struct timespec *);
 
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
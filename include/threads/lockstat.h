@@ -0,0 +1,50 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Lock contention profiler.
+
+   When the kernel is booted with -lockstat, lock_acquire(),
+   lock_release() and sema_down() record, for each lock class,
+   how often it was taken, how often a taker had to wait, how
+   long it waited and how long the lock was then held, and which
+   call sites did the waiting.  A class is every lock or
+   semaphore registered under the same name by lock_set_name()
+   or sema_set_name().  Unnamed locks share one class; unnamed
+   semaphores, which mostly wait for events rather than for
+   other threads, are not profiled.  Times are in time-stamp
+   counter cycles.  The report is printed at power off. */
+
+/* Number of call sites tracked per class. */
+#define LOCKSTAT_SITES 4
+
+/* A call site of a lock class. */
+struct lockstat_site {
+	void *pc;                   /* Return address of the acquire. */
+	long long acquisitions;     /* # of acquisitions from here. */
+	long long contended;        /* # of those that waited. */
+	uint64_t wait;              /* Total cycles waited here. */
+};
+
+/* A lock class. */
+struct lockstat {
+	const char *name;           /* Name, or null if slot unused. */
+	bool sema;                  /* Semaphores, not locks? */
+	long long acquisitions;     /* # of acquisitions. */
+	long long contended;        /* # of those that waited. */
+	uint64_t wait_total, wait_max;  /* Cycles spent waiting. */
+	uint64_t hold_total, hold_max;  /* Cycles held, for locks. */
+	struct lockstat_site sites[LOCKSTAT_SITES];
+};
+
+extern bool lockstat_enabled;
+
+struct lockstat *lockstat_register (const char *name, bool sema);
+void lockstat_acquired (struct lockstat *, bool contended, uint64_t wait,
+		void *pc);
+void lockstat_released (struct lockstat *, uint64_t hold);
+void lockstat_print_stats (void);
+
+#endif /* threads/lockstat.h */
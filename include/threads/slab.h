@@ -0,0 +1,52 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Object caches.
+
+   A cache hands out objects of one fixed size, for structures
+   allocated and freed so often that malloc()'s power-of-two
+   rounding and shared descriptor locks show.  Each cache carves
+   whole pages ("slabs") into exactly as many objects as fit, and
+   keeps the slabs that still have free objects on a partial list
+   and the others on a full list, so allocation and free take
+   constant time.
+
+   If the cache has a constructor, it is run once on each object
+   when its slab is created, and a freed object must be handed
+   back in its constructed state: kmem_cache_alloc() returns it
+   as is.  Without one, objects come back uninitialized. */
+
+typedef void kmem_ctor (void *obj);
+
+/* An object cache.  Callers allocate it, typically statically,
+   and set it up with kmem_cache_init(). */
+struct kmem_cache {
+	const char *name;           /* Name, for statistics. */
+	size_t size;                /* Size of an object, as requested. */
+	size_t stride;              /* Bytes between objects in a slab. */
+	size_t link_ofs;            /* Offset of the free list link. */
+	size_t objs_per_slab;       /* Objects in one slab. */
+	kmem_ctor *ctor;            /* Constructor, or null. */
+	struct hot_lock lock;       /* Protects everything below. */
+	struct list partial;        /* Slabs with free objects. */
+	struct list full;           /* Slabs without. */
+	struct slab *empty;         /* One spare slab, or null. */
+
+	/* Statistics. */
+	long long allocs;           /* # of objects allocated. */
+	long long frees;            /* # of objects freed. */
+	size_t slab_cnt;            /* # of slabs held, including EMPTY. */
+	size_t slab_max;            /* Most slabs held at once. */
+};
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_print_stats (void);
+
+#endif /* threads/slab.h */
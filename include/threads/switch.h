@@ -0,0 +1,23 @@
+#ifndef THREADS_SWITCH_H
+#define THREADS_SWITCH_H
+
+#include <stdint.h>
+
+struct intr_frame;
+
+/* Context switch.
+ *
+ * Threads only ever switch inside schedule(), at an ordinary
+ * function call, so the caller-saved registers are already dead
+ * and only the callee-saved ones need to survive the switch.
+ * switch_threads() pushes those onto the current stack, stores
+ * the stack pointer through SAVE_RSP, then pops the next
+ * thread's from NEXT_RSP and returns into it.
+ *
+ * A thread that has never run has no such stack yet; for it,
+ * switch_to_new() saves the current thread the same way and
+ * then starts the new one from its intr_frame with do_iret(). */
+void switch_threads (uint64_t *save_rsp, uint64_t next_rsp);
+void switch_to_new (uint64_t *save_rsp, struct intr_frame *next_tf);
+
+#endif /* threads/switch.h */
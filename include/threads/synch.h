@@ -2,35 +2,85 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pheap.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct lockstat;
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct pheap waiters;       /* Waiting threads, highest priority first. */
+	struct lockstat *stat;      /* Profile, if named; see lockstat.h. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_set_name (struct semaphore *, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_up_and_yield_to (struct semaphore *);
 void sema_self_test (void);
+void sema_waiter_reprioritize (struct thread *);
 
 /* Lock. */
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	int priority;               /* Highest priority donated through us. */
+	struct pheap_elem holder_elem; /* Element in holder's held_locks. */
+	struct lockstat *stat;      /* Profile, if named; see lockstat.h. */
+	uint64_t acquired_tsc;      /* When acquired, if profiling. */
 };
 
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Adaptive mutex.  A lock that, when contended, first spins
+   while the holder is running on another CPU, or donates its
+   priority and yields straight to the holder if the holder is
+   ready on this one, and only then parks like lock_acquire().
+   Priority donation behaves exactly as for struct lock. */
+struct mutex {
+	struct lock lock;           /* Underlying lock, parked on last. */
+};
+
+void mutex_init (struct mutex *);
+void mutex_set_name (struct mutex *, const char *name);
+void mutex_acquire (struct mutex *);
+bool mutex_try_acquire (struct mutex *);
+void mutex_release (struct mutex *);
+bool mutex_held_by_current_thread (const struct mutex *);
+
+/* Hot locks: the page pool, malloc descriptor and console locks,
+   whose critical sections are far shorter than a context switch.
+   Building with -DADAPTIVE_MUTEX puts them on struct mutex;
+   otherwise they are plain locks. */
+#ifdef ADAPTIVE_MUTEX
+#define hot_lock mutex
+#define hot_lock_init mutex_init
+#define hot_lock_set_name mutex_set_name
+#define hot_lock_acquire mutex_acquire
+#define hot_lock_release mutex_release
+#define hot_lock_held_by_current_thread mutex_held_by_current_thread
+#else
+#define hot_lock lock
+#define hot_lock_init lock_init
+#define hot_lock_set_name lock_set_name
+#define hot_lock_acquire lock_acquire
+#define hot_lock_release lock_release
+#define hot_lock_held_by_current_thread lock_held_by_current_thread
+#endif
+
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct pheap waiters;       /* Waiting threads, highest priority first. */
 };
 
 void cond_init (struct condition *);
@@ -38,6 +88,44 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.  Any number of readers may hold it at
+   once, or a single writer.  With writer preference, a new
+   reader queues behind any waiting writer instead of joining the
+   current readers, so a stream of readers cannot starve writers.
+
+   A thread that blocks donates its priority to every current
+   holder, each of which carries the donation through its own
+   struct rwlock_hold exactly as if it held a struct lock.  A
+   donation made to a blocked thread passes on the same way. */
+struct rwlock {
+	int readers;                /* # of readers holding it. */
+	struct thread *writer;      /* Writer holding it, or null. */
+	struct list holds;          /* Holders' struct rwlock_hold. */
+	struct semaphore read_waiters;  /* Blocked readers. */
+	struct semaphore write_waiters; /* Blocked writers. */
+	bool prefer_writers;        /* Readers yield to waiting writers. */
+};
+
+/* One thread's hold on a struct rwlock, allocated when the
+   thread asks for the rwlock and freed when it releases it.
+   While the thread waits, the hold lets donations made to it
+   continue on to the rwlock's holders. */
+struct rwlock_hold {
+	struct rwlock *rwlock;      /* Rwlock held or waited for. */
+	bool waiting;               /* Blocked waiting for rwlock? */
+	struct list_elem elem;      /* Element in rwlock's holds, once held. */
+	struct list_elem thread_elem; /* Element in thread's rw_holds. */
+	struct lock lock;           /* Carries donations to the holder. */
+};
+
+void rwlock_init (struct rwlock *, bool prefer_writers);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_write_held_by_current_thread (const struct rwlock *);
+struct rwlock *rwlock_waited_on (struct thread *);
+
 /* Optimization barrier.
  *
  * The compiler will not reorder operations across an
@@ -3,6 +3,8 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
+#include <rusage.h>
 #include <stdint.h>
 #include "threads/interrupt.h"
 
@@ -87,7 +89,7 @@ typedef int tid_t;
  * only because they are mutually exclusive: only a thread in the
  * ready state is on the run queue, whereas only a thread in the
  * blocked state is on a semaphore wait list. */
-#define FD_PAGES 2	//page는 2,3 다 상관 없음 (oom_update)
+#define FD_TABLE_MIN 16	/* Initial fd_table size, allocated on first open. */
 #define FD_MAX 128
 #define STD_IN 0
 #define STD_OUT 1
@@ -96,6 +98,16 @@ typedef int tid_t;
 #define PROCESS_ERR -1
 struct thread *get_thread_by_tid(tid_t tid);
 
+/* Resource usage of a thread, as reported by getrusage().  Kept
+   apart from struct thread, which shares its page with the
+   thread's kernel stack. */
+struct thread_usage {
+	struct rusage self;                 /* Our own usage so far. */
+	struct rusage children;             /* Sum over waited-for children. */
+	int64_t state_since;                /* Tick we last became ready or blocked. */
+	uint64_t woken_tsc;                 /* TSC when last woken, 0 if running since. */
+};
+
 struct thread {
 	/* Owned by thread.c. */
 	tid_t tid;                          /* Thread identifier. */
@@ -103,22 +115,44 @@ struct thread {
 	char name[16];                      /* Name (for debugging purposes). */
 	int priority;                       /* Donation Priority. */
 	
-	int ori_priority;
-	struct lock *wait_on_lock;
-	struct list donations;
-	struct list_elem donation_elem;
-	struct list_elem all_elem;
+	int ori_priority;                   /* Priority before donation. */
+	struct lock *wait_on_lock;          /* Lock we are blocked on. */
+	struct pheap held_locks;            /* Held locks, by donated priority. */
 
 	int nice;
 	int recent_cpu;
+	int64_t decay_epoch;                /* Last recent_cpu decay applied. */
+	int64_t vruntime;                   /* Weighted CPU time, under CFS. */
+	struct rb_elem cfs_elem;            /* CFS run queue element. */
+
+	/* Real-time class; see thread_set_deadline(). */
+	int64_t rt_runtime;                 /* Reserved ticks per period. */
+	int64_t rt_period;                  /* Period in ticks, 0 if not real-time. */
+	int64_t rt_deadline;                /* End of the current period. */
+	int64_t rt_budget;                  /* Ticks left in this period. */
+	bool rt_throttled;                  /* Budget used up this period? */
+	struct rb_elem rt_elem;             /* EDF run queue element. */
+	struct list_elem rt_allelem;        /* Element in real-time list. */
+
+	struct thread_usage *usage;         /* Accounting, or null. */
+	int64_t timer_slack;                /* Default timer_sleep() slack, in ticks. */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
 
+	/* Owned by synch.c. */
+	struct pheap_elem wait_elem;        /* Semaphore waiter heap element. */
+	uint64_t wait_seq;                  /* Orders waiters of equal priority. */
+	struct semaphore *blocked_sema;     /* Semaphore we are blocked on. */
+	struct condition *blocked_cond;     /* Condition we are waiting on. */
+	struct pheap_elem *blocked_cond_elem; /* Our element in its heap. */
+	struct list rw_holds;               /* Our struct rwlock_holds. */
+
 #ifdef USERPROG 👻 
 	/* Owned by userprog/process.c. */
 	uint64_t *pml4;                     /* Page map level 4 */
-	struct file **fd_table;
+	struct file **fd_table;             /* Open files by fd, or null. */
+	int fd_cap;                         /* # of slots in fd_table. */
 	int next_fd;
 
 	struct semaphore fork_sema;
@@ -137,7 +171,8 @@ struct thread {
 #endif
 
 	/* Owned by thread.c. */
-	struct intr_frame tf;               /* Information for switching */
+	struct intr_frame tf;               /* Information for first run. */
+	uint64_t switch_rsp;                /* Saved stack pointer, 0 before first run. */
 	struct intr_frame syscall_tf;
 	unsigned magic;                     /* Detects stack overflow. */
 };
@@ -145,23 +180,46 @@ struct thread {
 struct sleeping_thread {
 	struct thread *t;
 	int64_t wakeup_ticks;
+	bool slacked;                       /* Woken late to share a tick? */
 	struct list_elem elem;
 };
 
 void check_priority();
 void print_ready_list(void);
-static struct list ready_list;
+void thread_update_priority (struct thread *, int priority);
+
+/* Priority donation. */
+extern int donation_depth_limit;
+void donate_priority (void);
+void refresh_priority (void);
+int effective_priority (const struct thread *);
+void add_with_lock (struct lock *);
+void remove_with_lock (struct lock *);
+void add_held_lock (struct thread *, struct lock *);
+void update_lock_priority (struct lock *, int priority);
+
+/* MLFQS bookkeeping, driven by the timer interrupt. */
+void mlfqs_incr (void);
+void mlfqs_load_avg (void);
+void mlfqs_recalculate_priority (void);
+void mlfqs_recalculate_recent_cpu (void);
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler.
+   Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
-void thread_tick (void);
+void thread_tick (bool user);
+void thread_account_idle (int64_t cnt);
 void thread_print_stats (void);
+void thread_rusage_add (struct rusage *, const struct rusage *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -170,13 +228,16 @@ void thread_block (void);
 void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
+bool thread_others_ready (void);
 tid_t thread_tid (void);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_yield_to (struct thread *);
 
 int thread_get_priority (void);
+bool thread_set_deadline (int64_t runtime, int64_t period);
 void thread_set_priority (int);
 
 int thread_get_nice (void);
@@ -0,0 +1,73 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Scheduler event tracing.
+
+   Records scheduling events, each stamped with the time-stamp
+   counter, into a fixed-size ring buffer in memory.  The buffer
+   is printed to the console at power off, or when Ctrl-T is
+   typed, and utils/sched-trace turns the printout into a
+   timeline that chrome://tracing or Perfetto can display.
+
+   Tracing is built in only when SCHED_TRACE is defined, and then
+   turned on at boot with the -trace option.  Otherwise TRACE()
+   expands to nothing; when built in but off, it costs a single
+   well-predicted branch. */
+
+/* Event types.  TID is always the thread the event is about. */
+enum trace_type {
+	TRACE_SWITCH,           /* TID switched to ARG; DATA is TID's status. */
+	TRACE_WAKEUP,           /* TID made ready by ARG (0 if interrupt). */
+	TRACE_DONATE,           /* TID donated priority DATA to ARG. */
+	TRACE_SLEEP,            /* TID sleeps until timer tick DATA. */
+	TRACE_TIMER_WAKE,       /* TID woken by the timer at tick DATA. */
+	TRACE_LOCK_WAIT,        /* TID blocks on lock DATA, held by ARG. */
+	TRACE_LOCK_ACQUIRE,     /* TID acquired lock DATA after waiting. */
+	TRACE_NAME,             /* TID is named NAME. */
+};
+
+/* A trace record.  32 bytes, so two fit in a cache line. */
+struct trace_record {
+	uint64_t tsc;           /* Time-stamp counter. */
+	uint16_t type;          /* One of enum trace_type. */
+	uint16_t cpu;           /* CPU the event happened on. */
+	int32_t tid;            /* Thread the event is about. */
+	union {
+		struct {
+			int32_t arg;            /* Other thread, if any. */
+			int32_t pad;
+			int64_t data;           /* Type-specific value. */
+		};
+		char name[16];          /* TRACE_NAME: thread name. */
+	};
+};
+
+#ifdef SCHED_TRACE
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_log (enum trace_type, int tid, int arg, int64_t data);
+void trace_name (int tid, const char *name);
+void trace_dump (void);
+
+#define TRACE(TYPE, TID, ARG, DATA)                              \
+	do {                                                           \
+		if (__builtin_expect (trace_enabled, 0))                     \
+			trace_log (TYPE, TID, ARG, DATA);                          \
+	} while (0)
+#define TRACE_NAME_THREAD(TID, NAME)                             \
+	do {                                                           \
+		if (__builtin_expect (trace_enabled, 0))                     \
+			trace_name (TID, NAME);                                    \
+	} while (0)
+#else
+#define trace_init() ((void) 0)
+#define trace_dump() ((void) 0)
+#define TRACE(TYPE, TID, ARG, DATA) ((void) 0)
+#define TRACE_NAME_THREAD(TID, NAME) ((void) 0)
+#endif
+
+#endif /* threads/trace.h */
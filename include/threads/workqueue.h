@@ -0,0 +1,59 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Deferred work.
+
+   An interrupt handler runs with interrupts off, so everything it
+   does delays every other interrupt.  A handler should therefore
+   do only what cannot wait -- acknowledge the device, move data
+   out of its buffers, wake a waiting thread -- and schedule the
+   rest as a work item.  Each priority has a kernel worker thread
+   that runs its items, in the order they were scheduled, with
+   interrupts on.
+
+   work_schedule() takes no lock and never sleeps, so it may be
+   called from interrupt context.  Scheduling an item that is
+   already pending has no effect: the item runs once.  An item
+   may be scheduled again while it runs, and then runs again.
+
+   When the kernel is booted with -no-defer, work_schedule() runs
+   the item at once instead, in the caller's context.  This is
+   what interrupt handlers did before they deferred any work. */
+
+/* Priority of a work item, which is the priority of the worker
+   that runs it. */
+enum work_prio {
+	WORK_HIGH,                  /* Scheduler bookkeeping. */
+	WORK_DEFAULT,               /* Device bottom halves. */
+	WORK_LOW,                   /* Diagnostics; no more urgent than
+	                               an ordinary thread. */
+	WORK_PRIO_CNT
+};
+
+typedef void work_func (void *aux);
+
+/* A work item.  The owner allocates it, typically statically,
+   and must not free it while it is pending. */
+struct work {
+	work_func *func;            /* Function to run. */
+	void *aux;                  /* Its argument. */
+	enum work_prio prio;        /* Which worker runs it. */
+	bool pending;               /* Scheduled but not yet started? */
+	uint64_t queued_tsc;        /* When it was scheduled. */
+	struct work *next;          /* Next item in its queue. */
+};
+
+/* Run deferred work inline?  Set by "-no-defer". */
+extern bool work_inline;
+
+void workqueue_init (void);
+void workqueue_start (void);
+void workqueue_print_stats (void);
+
+void work_init (struct work *, work_func *, void *aux, enum work_prio);
+bool work_schedule (struct work *);
+
+#endif /* threads/workqueue.h */
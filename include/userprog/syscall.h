@@ -3,9 +3,12 @@
 #include <stdbool.h>
 #include <debug.h>
 #include <stddef.h>
+#include <rusage.h>
+#include <time.h>
 
 typedef int pid_t;
 extern struct lock syscall_lock;
+struct thread;
 
 void syscall_init (void);
 void halt (void);
@@ -13,6 +16,8 @@ void exit (int status);
 // pid_t fork (const char *thread_name, struct intr_frame *f); //compile error 때문에 없앰.
 int exec (const char *cmd_line);
 int wait (pid_t pid);
+int getrusage (int who, struct rusage *usage);
+int clock_gettime (clockid_t clock, struct timespec *tp);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -22,5 +27,6 @@ int write (int fd, const void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+bool fd_table_reserve (struct thread *, int cnt);
 
 #endif /* userprog/syscall.h */
@@ -15,7 +15,7 @@ static void putchar_have_lock (uint8_t c);
    safe to call them at any time.
    But this lock is useful to prevent simultaneous printf() calls
    from mixing their output, which looks confusing. */
-static struct lock console_lock;
+static struct hot_lock console_lock;
 
 /* True in ordinary circumstances: we want to use the console
    lock to avoid mixing output between threads, as explained
@@ -62,7 +62,8 @@ static int64_t write_cnt;
 /* Enable console locking. */
 void
 console_init (void) {
-	lock_init (&console_lock);
+	hot_lock_init (&console_lock);
+	hot_lock_set_name (&console_lock, "console");
 	use_console_lock = true;
 }
 
@@ -84,10 +85,10 @@ console_print_stats (void) {
 	static void
 acquire_console (void) {
 	if (!intr_context () && use_console_lock) {
-		if (lock_held_by_current_thread (&console_lock)) 
+		if (hot_lock_held_by_current_thread (&console_lock)) 
 			console_lock_depth++; 
 		else
-			lock_acquire (&console_lock); 
+			hot_lock_acquire (&console_lock); 
 	}
 }
 
@@ -98,7 +99,7 @@ release_console (void) {
 		if (console_lock_depth > 0)
 			console_lock_depth--;
 		else
-			lock_release (&console_lock); 
+			hot_lock_release (&console_lock); 
 	}
 }
 
@@ -108,7 +109,7 @@ static bool
 console_locked_by_current_thread (void) {
 	return (intr_context ()
 			|| !use_console_lock
-			|| lock_held_by_current_thread (&console_lock));
+			|| hot_lock_held_by_current_thread (&console_lock));
 }
 
 /* The standard vprintf() function,
@@ -0,0 +1,167 @@
+#include "pheap.h"
+#include "../debug.h"
+
+/* Pairing heap.  See pheap.h for an overview.
+
+   Each node keeps a pointer to its leftmost child, and the
+   children of a node form a doubly linked sibling list through
+   `next' and `prev'.  The leftmost child's `prev' points to the
+   parent instead, which is what lets an arbitrary element be cut
+   out of the tree in O(1) time. */
+
+static struct pheap_elem *meld (struct pheap *,
+		struct pheap_elem *, struct pheap_elem *);
+static struct pheap_elem *merge_pairs (struct pheap *,
+		struct pheap_elem *first);
+
+/* Initializes heap H as empty, ordered by LESS given auxiliary
+   data AUX. */
+void
+pheap_init (struct pheap *h, pheap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->size = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into heap H. */
+void
+pheap_insert (struct pheap *h, struct pheap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->size++;
+}
+
+/* Returns the greatest element in H, which must not be empty. */
+struct pheap_elem *
+pheap_max (const struct pheap *h) {
+	ASSERT (!pheap_empty (h));
+	return h->root;
+}
+
+/* Removes and returns the greatest element in H, which must not
+   be empty. */
+struct pheap_elem *
+pheap_pop_max (struct pheap *h) {
+	struct pheap_elem *max;
+
+	ASSERT (!pheap_empty (h));
+
+	max = h->root;
+	h->root = merge_pairs (h, max->child);
+	h->size--;
+	max->child = NULL;
+	return max;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+pheap_remove (struct pheap *h, struct pheap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		pheap_pop_max (h);
+		return;
+	}
+
+	/* Cut E's subtree out of its sibling list. */
+	ASSERT (e->prev != NULL);
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+
+	/* Put E's children back into the heap. */
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	h->size--;
+	e->child = e->next = e->prev = NULL;
+}
+
+/* Restores heap order after the value of E, which must be in H,
+   has changed. */
+void
+pheap_update (struct pheap *h, struct pheap_elem *e) {
+	pheap_remove (h, e);
+	pheap_insert (h, e);
+}
+
+/* Returns the number of elements in H. */
+size_t
+pheap_size (const struct pheap *h) {
+	ASSERT (h != NULL);
+	return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+pheap_empty (const struct pheap *h) {
+	ASSERT (h != NULL);
+	return h->root == NULL;
+}
+
+/* Links the trees rooted at A and B, either of which may be
+   null, and returns the root of the result. */
+static struct pheap_elem *
+meld (struct pheap *h, struct pheap_elem *a, struct pheap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	/* Make A the greater root.  On ties the existing root wins,
+	   which keeps equal elements in insertion order. */
+	if (h->less (a, b, h->aux)) {
+		struct pheap_elem *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	/* B becomes A's leftmost child. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Combines the sibling list starting at FIRST into a single tree
+   and returns its root.  Siblings are melded in pairs from left
+   to right, and the pairs are then melded from right to left. */
+static struct pheap_elem *
+merge_pairs (struct pheap *h, struct pheap_elem *first) {
+	struct pheap_elem *pairs = NULL;
+	struct pheap_elem *root = NULL;
+
+	while (first != NULL) {
+		struct pheap_elem *a = first;
+		struct pheap_elem *b = a->next;
+		struct pheap_elem *m;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL)
+			b->next = b->prev = NULL;
+
+		m = meld (h, a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+
+	while (pairs != NULL) {
+		struct pheap_elem *m = pairs;
+		pairs = m->next;
+		m->next = NULL;
+		root = meld (h, root, m);
+	}
+	return root;
+}
@@ -0,0 +1,305 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/* Red-black tree.  See rbtree.h for an overview.
+
+   This is the classic algorithm (see CLRS, chapter 13), with null
+   pointers standing in for the black leaves.  Removal therefore
+   tracks the parent of the node it is fixing up separately,
+   since that node may be null. */
+
+static void rotate_left (struct rbtree *, struct rb_elem *);
+static void rotate_right (struct rbtree *, struct rb_elem *);
+static void replace_child (struct rbtree *, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new);
+static void insert_fixup (struct rbtree *, struct rb_elem *);
+static void remove_fixup (struct rbtree *, struct rb_elem *,
+		struct rb_elem *parent);
+static bool is_red (const struct rb_elem *);
+
+/* Initializes tree T as empty, ordered by LESS given auxiliary
+   data AUX. */
+void
+rb_init (struct rbtree *t, rb_less_func *less, void *aux) {
+	ASSERT (t != NULL);
+	ASSERT (less != NULL);
+
+	t->root = t->min = NULL;
+	t->size = 0;
+	t->less = less;
+	t->aux = aux;
+}
+
+/* Inserts E into tree T, after any elements equal to it. */
+void
+rb_insert (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem **link = &t->root;
+	struct rb_elem *parent = NULL;
+
+	ASSERT (t != NULL);
+	ASSERT (e != NULL);
+
+	while (*link != NULL) {
+		parent = *link;
+		link = t->less (e, parent, t->aux) ? &parent->left : &parent->right;
+	}
+	e->parent = parent;
+	e->left = e->right = NULL;
+	e->red = true;
+	*link = e;
+
+	if (t->min == NULL || t->less (e, t->min, t->aux))
+		t->min = e;
+	t->size++;
+	insert_fixup (t, e);
+}
+
+/* Removes E, which must be in tree T, from T. */
+void
+rb_remove (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem *x, *x_parent;
+	bool removed_red;
+
+	ASSERT (t != NULL);
+	ASSERT (e != NULL);
+	ASSERT (t->size > 0);
+
+	if (t->min == e)
+		t->min = rb_next (e);
+
+	if (e->left == NULL || e->right == NULL) {
+		/* E has at most one child, which takes its place. */
+		x = e->left != NULL ? e->left : e->right;
+		x_parent = e->parent;
+		removed_red = e->red;
+		replace_child (t, e->parent, e, x);
+		if (x != NULL)
+			x->parent = e->parent;
+	} else {
+		/* E's successor Y, which has no left child, takes its
+		   place, and Y's right child takes Y's. */
+		struct rb_elem *y = e->right;
+		while (y->left != NULL)
+			y = y->left;
+		removed_red = y->red;
+		x = y->right;
+		if (y->parent == e)
+			x_parent = y;
+		else {
+			x_parent = y->parent;
+			replace_child (t, y->parent, y, x);
+			if (x != NULL)
+				x->parent = y->parent;
+			y->right = e->right;
+			y->right->parent = y;
+		}
+		replace_child (t, e->parent, e, y);
+		y->parent = e->parent;
+		y->left = e->left;
+		y->left->parent = y;
+		y->red = e->red;
+	}
+	t->size--;
+
+	if (!removed_red)
+		remove_fixup (t, x, x_parent);
+}
+
+/* Returns the least element in T, which must not be empty. */
+struct rb_elem *
+rb_min (const struct rbtree *t) {
+	ASSERT (!rb_empty (t));
+	return t->min;
+}
+
+/* Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) {
+	ASSERT (e != NULL);
+
+	if (e->right != NULL) {
+		e = e->right;
+		while (e->left != NULL)
+			e = e->left;
+		return (struct rb_elem *) e;
+	}
+	while (e->parent != NULL && e == e->parent->right)
+		e = e->parent;
+	return e->parent;
+}
+
+/* Returns the number of elements in T. */
+size_t
+rb_size (const struct rbtree *t) {
+	ASSERT (t != NULL);
+	return t->size;
+}
+
+/* Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rbtree *t) {
+	ASSERT (t != NULL);
+	return t->root == NULL;
+}
+
+/* Restores the red-black properties after E was inserted red. */
+static void
+insert_fixup (struct rbtree *t, struct rb_elem *e) {
+	struct rb_elem *parent;
+
+	while ((parent = e->parent) != NULL && parent->red) {
+		/* The root is black, so a red parent has a parent. */
+		struct rb_elem *grandparent = parent->parent;
+
+		if (parent == grandparent->left) {
+			struct rb_elem *uncle = grandparent->right;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+				continue;
+			}
+			if (e == parent->right) {
+				rotate_left (t, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grandparent->red = true;
+			rotate_right (t, grandparent);
+		} else {
+			struct rb_elem *uncle = grandparent->left;
+			if (is_red (uncle)) {
+				parent->red = uncle->red = false;
+				grandparent->red = true;
+				e = grandparent;
+				continue;
+			}
+			if (e == parent->left) {
+				rotate_right (t, parent);
+				e = parent;
+				parent = e->parent;
+			}
+			parent->red = false;
+			grandparent->red = true;
+			rotate_left (t, grandparent);
+		}
+	}
+	t->root->red = false;
+}
+
+/* Restores the red-black properties after a black node was
+   removed from above X, whose parent is PARENT.  X, which may be
+   null, carries an extra black that is pushed up the tree until
+   it can be absorbed. */
+static void
+remove_fixup (struct rbtree *t, struct rb_elem *x, struct rb_elem *parent) {
+	while (x != t->root && !is_red (x)) {
+		/* X's side is one black short, so its sibling W has at
+		   least one black node below it and is not null. */
+		if (x == parent->left) {
+			struct rb_elem *w = parent->right;
+			if (w->red) {
+				w->red = false;
+				parent->red = true;
+				rotate_left (t, parent);
+				w = parent->right;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->right)) {
+					w->left->red = false;
+					w->red = true;
+					rotate_right (t, w);
+					w = parent->right;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->right->red = false;
+				rotate_left (t, parent);
+				x = t->root;
+			}
+		} else {
+			struct rb_elem *w = parent->left;
+			if (w->red) {
+				w->red = false;
+				parent->red = true;
+				rotate_right (t, parent);
+				w = parent->left;
+			}
+			if (!is_red (w->left) && !is_red (w->right)) {
+				w->red = true;
+				x = parent;
+				parent = x->parent;
+			} else {
+				if (!is_red (w->left)) {
+					w->right->red = false;
+					w->red = true;
+					rotate_left (t, w);
+					w = parent->left;
+				}
+				w->red = parent->red;
+				parent->red = false;
+				w->left->red = false;
+				rotate_right (t, parent);
+				x = t->root;
+			}
+		}
+	}
+	if (x != NULL)
+		x->red = false;
+}
+
+/* Rotates the subtree rooted at X to the left, so that X's right
+   child takes its place. */
+static void
+rotate_left (struct rbtree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->right;
+
+	x->right = y->left;
+	if (y->left != NULL)
+		y->left->parent = x;
+	y->parent = x->parent;
+	replace_child (t, x->parent, x, y);
+	y->left = x;
+	x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, so that X's left
+   child takes its place. */
+static void
+rotate_right (struct rbtree *t, struct rb_elem *x) {
+	struct rb_elem *y = x->left;
+
+	x->left = y->right;
+	if (y->right != NULL)
+		y->right->parent = x;
+	y->parent = x->parent;
+	replace_child (t, x->parent, x, y);
+	y->right = x;
+	x->parent = y;
+}
+
+/* Makes NEW the child of PARENT in place of OLD, or the root of T
+   if PARENT is null.  Does not update NEW's parent pointer. */
+static void
+replace_child (struct rbtree *t, struct rb_elem *parent,
+		struct rb_elem *old, struct rb_elem *new) {
+	if (parent == NULL)
+		t->root = new;
+	else if (parent->left == old)
+		parent->left = new;
+	else
+		parent->right = new;
+}
+
+/* Returns true if E is a red node, false if it is black or a
+   null leaf. */
+static bool
+is_red (const struct rb_elem *e) {
+	return e != NULL && e->red;
+}
@@ -0,0 +1,116 @@
+/* Measures the cost of a context switch between kernel threads.
+
+   First two threads yield to each other, then two threads
+   ping-pong on a pair of semaphores, so that every switch blocks
+   one thread and wakes the other.  Reports switches per second
+   and time-stamp counter cycles per switch for each, to compare
+   builds of the scheduler against each other.  The only thing
+   checked is that every switch happened. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define SWITCHES 100000         /* Switches per measurement. */
+
+struct switch_test
+  {
+    struct semaphore ping, pong;  /* Ping-pong semaphores. */
+    struct semaphore done;      /* Upped by each finished thread. */
+    int switches;               /* # of switches so far. */
+  };
+
+static thread_func yielder, pinger, ponger;
+static void measure (const char *, thread_func *, thread_func *);
+
+void
+test_context_switch (void)
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  measure ("yield", yielder, yielder);
+  measure ("semaphore", pinger, ponger);
+}
+
+/* Runs A and B above our priority until they have switched
+   SWITCHES times between them, and reports how fast that was. */
+static void
+measure (const char *name, thread_func *a, thread_func *b)
+{
+  struct switch_test test;
+  int64_t start_ticks, ticks;
+  uint64_t start_tsc, cycles;
+
+  sema_init (&test.ping, 0);
+  sema_init (&test.pong, 0);
+  sema_init (&test.done, 0);
+  test.switches = 0;
+
+  start_ticks = timer_ticks ();
+  start_tsc = rdtsc ();
+  thread_create ("switcher a", PRI_DEFAULT + 1, a, &test);
+  thread_create ("switcher b", PRI_DEFAULT + 1, b, &test);
+  sema_down (&test.done);
+  sema_down (&test.done);
+  cycles = rdtsc () - start_tsc;
+  ticks = timer_elapsed (start_ticks);
+
+  if (test.switches < SWITCHES)
+    fail ("%s: only %d of %d switches", name, test.switches, SWITCHES);
+  if (ticks < 1)
+    ticks = 1;
+  msg ("%s: %lld switches per second, %llu cycles per switch",
+       name, (long long) SWITCHES * TIMER_FREQ / ticks,
+       (unsigned long long) (cycles / SWITCHES));
+}
+
+/* Yields until the two yielders have switched SWITCHES times. */
+static void
+yielder (void *test_)
+{
+  struct switch_test *test = test_;
+
+  while (test->switches < SWITCHES)
+    {
+      test->switches++;
+      thread_yield ();
+    }
+  sema_up (&test->done);
+}
+
+/* Wakes the ponger and waits to be woken in turn. */
+static void
+pinger (void *test_)
+{
+  struct switch_test *test = test_;
+  int i;
+
+  for (i = 0; i < SWITCHES / 2; i++)
+    {
+      test->switches++;
+      sema_up (&test->ping);
+      sema_down (&test->pong);
+    }
+  sema_up (&test->done);
+}
+
+/* Waits to be woken by the pinger and wakes it in turn. */
+static void
+ponger (void *test_)
+{
+  struct switch_test *test = test_;
+  int i;
+
+  for (i = 0; i < SWITCHES / 2; i++)
+    {
+      sema_down (&test->ping);
+      test->switches++;
+      sema_up (&test->pong);
+    }
+  sema_up (&test->done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $kind ('yield', 'semaphore') {
+    fail "missing $kind switch rate\n"
+      if !grep (/^\(context-switch\) $kind: \d+ switches per second, \d+ cycles per switch$/, @output);
+}
+fail "unexpected output\n"
+  if grep (!/^\(context-switch\) (begin|end|\w+: \d+ switches)/, @output);
+pass;
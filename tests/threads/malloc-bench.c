@@ -0,0 +1,126 @@
+/* Measures malloc() speed and fragmentation.
+
+   Fills a set of slots with blocks of random sizes, mostly small
+   with some up to a page, then repeatedly frees a random slot's
+   block or allocates a new one into an empty slot.  Reports
+   operations per second and time-stamp counter cycles per
+   operation, and the fraction of the pages malloc() holds that
+   is not covered by the bytes requested.  Finally frees every
+   block and checks that malloc() gave all its arenas back. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#include "intrinsic.h"
+
+#define SLOTS 1024              /* Blocks live at once, at most. */
+#define OPS 200000              /* Operations in the churn phase. */
+
+static void *blocks[SLOTS];     /* Live blocks, or null. */
+static size_t sizes[SLOTS];     /* Requested size of each block. */
+static size_t requested;        /* Sum of SIZES of live blocks. */
+
+static uint64_t rand_state = 0x2545f4914f6cdd1dULL;
+
+static uint64_t next_rand (void);
+static size_t random_size (void);
+static void toggle (int slot);
+static void report (const char *, int ops, int64_t ns, uint64_t cycles,
+                    size_t base);
+
+void
+test_malloc_bench (void)
+{
+  size_t base = malloc_pages ();
+  int64_t start_ns;
+  uint64_t start_tsc;
+  int i;
+
+  /* Fill every slot. */
+  start_ns = timer_ns ();
+  start_tsc = rdtsc ();
+  for (i = 0; i < SLOTS; i++)
+    toggle (i);
+  report ("fill", SLOTS, timer_ns () - start_ns, rdtsc () - start_tsc, base);
+
+  /* Free and allocate at random. */
+  start_ns = timer_ns ();
+  start_tsc = rdtsc ();
+  for (i = 0; i < OPS; i++)
+    toggle (next_rand () % SLOTS);
+  report ("churn", OPS, timer_ns () - start_ns, rdtsc () - start_tsc, base);
+
+  /* Free everything. */
+  for (i = 0; i < SLOTS; i++)
+    if (blocks[i] != NULL)
+      toggle (i);
+  if (malloc_pages () > base)
+    fail ("%zu pages still held after freeing every block",
+          malloc_pages () - base);
+  msg ("all arenas released");
+}
+
+/* Returns a pseudo-random number.  Cheaper than random_ulong(),
+   so that it does not show in the timings, and independent of the
+   kernel's seed. */
+static uint64_t
+next_rand (void)
+{
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 7;
+  rand_state ^= rand_state << 17;
+  return rand_state;
+}
+
+/* Returns a block size: three in four up to 256 bytes, the rest
+   up to 4 kB, which includes some blocks too big for an arena. */
+static size_t
+random_size (void)
+{
+  uint64_t r = next_rand ();
+
+  if (r % 4 != 0)
+    return 1 + (r >> 8) % 256;
+  else
+    return 1 + (r >> 8) % PGSIZE;
+}
+
+/* Frees SLOT's block if it has one, otherwise allocates one. */
+static void
+toggle (int slot)
+{
+  if (blocks[slot] != NULL)
+    {
+      free (blocks[slot]);
+      blocks[slot] = NULL;
+      requested -= sizes[slot];
+    }
+  else
+    {
+      sizes[slot] = random_size ();
+      blocks[slot] = malloc (sizes[slot]);
+      if (blocks[slot] == NULL)
+        fail ("malloc (%zu) failed", sizes[slot]);
+      requested += sizes[slot];
+    }
+}
+
+/* Reports the speed of OPS operations that took NS nanoseconds
+   and CYCLES cycles, and the fragmentation of the pages malloc()
+   has gained since it held BASE pages. */
+static void
+report (const char *name, int ops, int64_t ns, uint64_t cycles, size_t base)
+{
+  size_t held = (malloc_pages () - base) * PGSIZE;
+
+  if (ns < 1)
+    ns = 1;
+  msg ("%s: %lld ops per second, %llu cycles per op",
+       name, (long long) ops * 1000000000 / ns,
+       (unsigned long long) (cycles / ops));
+  msg ("%s: %zu bytes requested in %zu kB, %zu%% fragmentation",
+       name, requested, held / 1024,
+       held > requested ? (held - requested) * 100 / held : 0);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+foreach my $phase ('fill', 'churn') {
+    fail "missing $phase operation rate\n"
+      if !grep (/^\(malloc-bench\) $phase: \d+ ops per second, \d+ cycles per op$/, @output);
+    fail "missing $phase fragmentation\n"
+      if !grep (/^\(malloc-bench\) $phase: \d+ bytes requested in \d+ kB, \d+% fragmentation$/, @output);
+}
+fail "arenas not released\n"
+  if !grep (/^\(malloc-bench\) all arenas released$/, @output);
+fail "unexpected output\n"
+  if grep (!/^\(malloc-bench\) (begin|end|all arenas released|\w+: \d+ )/, @output);
+pass;
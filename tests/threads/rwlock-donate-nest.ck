@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate-nest) begin
+(rwlock-donate-nest) Low thread should have priority 32.  Actual priority: 32.
+(rwlock-donate-nest) Low thread should have priority 33.  Actual priority: 33.
+(rwlock-donate-nest) Medium thread should have priority 33.  Actual priority: 33.
+(rwlock-donate-nest) Medium thread got the rwlock.
+(rwlock-donate-nest) High thread got the lock.
+(rwlock-donate-nest) High thread finished.
+(rwlock-donate-nest) High thread should have just finished.
+(rwlock-donate-nest) Middle thread finished.
+(rwlock-donate-nest) Medium thread should just have finished.
+(rwlock-donate-nest) Low thread should have priority 31.  Actual priority: 31.
+(rwlock-donate-nest) end
@@ -0,0 +1,138 @@
+/* Checks that a reader-writer lock lets readers in together.
+   Each reader holds the lock across a one-tick sleep, so if
+   readers were serialized, N of them would take N times as long
+   as one.  Instead they should all finish in about the time one
+   reader takes, so read throughput grows with the number of
+   readers.
+
+   Then runs readers and writers against each other with writer
+   preference, and verifies that no reader ever observes a write
+   in progress and that the writers are not starved. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 10           /* Acquisitions per thread. */
+#define MAX_READERS 8
+
+struct rwlock_test
+  {
+    struct rwlock rwlock;       /* Lock under test. */
+    struct semaphore done;      /* Upped by each finished thread. */
+    int before, after;          /* Equal except mid-write. */
+    int torn_reads;             /* # of reads that saw a write. */
+    int reads, writes;          /* # of completed operations. */
+  };
+
+static thread_func reader, writer;
+static int64_t run_readers (struct rwlock_test *, int reader_cnt);
+
+void
+test_rwlock_scale (void)
+{
+  struct rwlock_test test;
+  int64_t base;
+  int reader_cnt;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&test.rwlock, false);
+  sema_init (&test.done, 0);
+  test.before = test.after = 0;
+  test.torn_reads = 0;
+
+  base = run_readers (&test, 1);
+  for (reader_cnt = 2; reader_cnt <= MAX_READERS; reader_cnt *= 2)
+    {
+      int64_t elapsed = run_readers (&test, reader_cnt);
+      if (elapsed > 2 * base)
+        fail ("%d readers took %lld ticks, but 1 reader took %lld",
+              reader_cnt, elapsed, base);
+      msg ("%d readers: %d reads in about the time of %d",
+           reader_cnt, reader_cnt * ITERATIONS, ITERATIONS);
+    }
+
+  rwlock_init (&test.rwlock, true);
+  test.reads = test.writes = 0;
+  for (i = 0; i < 4; i++)
+    thread_create ("reader", PRI_DEFAULT, reader, &test);
+  for (i = 0; i < 2; i++)
+    thread_create ("writer", PRI_DEFAULT, writer, &test);
+  for (i = 0; i < 6; i++)
+    sema_down (&test.done);
+
+  if (test.torn_reads != 0)
+    fail ("%d reads saw a write in progress", test.torn_reads);
+  msg ("%d reads and %d writes, no torn reads", test.reads, test.writes);
+}
+
+/* Runs READER_CNT readers to completion and returns the number
+   of timer ticks they took. */
+static int64_t
+run_readers (struct rwlock_test *test, int reader_cnt)
+{
+  int64_t start = timer_ticks ();
+  int i;
+
+  test->reads = 0;
+  for (i = 0; i < reader_cnt; i++)
+    thread_create ("reader", PRI_DEFAULT, reader, test);
+  for (i = 0; i < reader_cnt; i++)
+    sema_down (&test->done);
+  if (test->torn_reads != 0 || test->reads != reader_cnt * ITERATIONS)
+    fail ("readers went wrong");
+  return timer_elapsed (start);
+}
+
+static void
+reader (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      enum intr_level old_level;
+      bool torn;
+
+      rwlock_acquire_read (&test->rwlock);
+      torn = test->before != test->after;
+      timer_sleep (1);
+      torn = torn || test->before != test->after;
+
+      /* Other readers update the counters concurrently. */
+      old_level = intr_disable ();
+      test->torn_reads += torn;
+      test->reads++;
+      intr_set_level (old_level);
+      rwlock_release_read (&test->rwlock);
+    }
+  sema_up (&test->done);
+}
+
+static void
+writer (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      rwlock_acquire_write (&test->rwlock);
+      test->before++;
+      timer_sleep (1);
+      test->after++;
+      test->writes++;
+      rwlock_release_write (&test->rwlock);
+      thread_yield ();
+    }
+  sema_up (&test->done);
+}
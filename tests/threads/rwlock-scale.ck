@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-scale) begin
+(rwlock-scale) 2 readers: 20 reads in about the time of 10
+(rwlock-scale) 4 readers: 40 reads in about the time of 10
+(rwlock-scale) 8 readers: 80 reads in about the time of 10
+(rwlock-scale) 40 reads and 20 writes, no torn reads
+(rwlock-scale) end
+EOF
+pass;
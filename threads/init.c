@@ -14,13 +14,17 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -80,12 +84,14 @@ main (void) {
 	/* Initialize ourselves as a thread so we can use locks,
 	   then enable console locking. */
 	thread_init ();
+	workqueue_init ();
 	console_init ();
 
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
 	paging_init (mem_end);
+	trace_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -103,6 +109,8 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	workqueue_start ();
+	palloc_start_zeroing ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -221,6 +229,22 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-cfs"))
+			thread_cfs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-donate-depth"))
+			donation_depth_limit = atoi (value);
+		else if (!strcmp (name, "-lockstat"))
+			lockstat_enabled = true;
+		else if (!strcmp (name, "-no-defer"))
+			work_inline = true;
+		else if (!strcmp (name, "-no-prezero"))
+			palloc_no_prezero = true;
+#ifdef SCHED_TRACE
+		else if (!strcmp (name, "-trace"))
+			trace_enabled = true;
+#endif
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -230,6 +254,8 @@ parse_options (char **argv) {
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
 	}
+	if (thread_mlfqs && thread_cfs)
+		PANIC ("-mlfqs and -cfs cannot be used together");
 
 	return argv;
 }
@@ -326,6 +352,15 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -cfs               Use completely fair scheduler.\n"
+			"  -tickless          Stop the timer tick while the CPU is idle.\n"
+			"  -donate-depth=N    Propagate priority donation through N locks.\n"
+			"  -lockstat          Profile lock contention, report at power off.\n"
+			"  -no-defer          Do deferred interrupt work in the handlers.\n"
+			"  -no-prezero        Zero pages only when they are allocated.\n"
+#ifdef SCHED_TRACE
+			"  -trace             Record scheduler events; Ctrl-T dumps them.\n"
+#endif
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -342,6 +377,7 @@ power_off (void) {
 	filesys_done ();
 #endif
 
+	trace_dump ();
 	print_stats ();
 
 	printf ("Powering off...\n");
@@ -354,6 +390,11 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	kmem_print_stats ();
+	lockstat_print_stats ();
+	intr_print_stats ();
+	workqueue_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
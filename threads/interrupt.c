@@ -103,6 +103,19 @@ static const char *intr_names[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Interrupts-off time, in time-stamp counter cycles.
+   INTR_OFF_SINCE is when interrupts were last turned off, or 0
+   if they are on or we did not see them go off.  A window ends
+   when intr_enable() or an interrupt return turns them back on. */
+static uint64_t intr_off_since;
+static uint64_t intr_off_max;           /* Longest window. */
+static void *intr_off_max_pc;           /* Code that ended it. */
+static uint64_t handler_max[16];        /* Longest run of each
+                                           external handler. */
+
+static enum intr_level enable (void *pc);
+static void intr_off_end (void *pc);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -128,15 +141,26 @@ intr_get_level (void) {
    returns the previous interrupt status. */
 enum intr_level
 intr_set_level (enum intr_level level) {
-	return level == INTR_ON ? intr_enable () : intr_disable ();
+	return (level == INTR_ON
+			? enable (__builtin_return_address (0)) : intr_disable ());
 }
 
 /* Enables interrupts and returns the previous interrupt status. */
 enum intr_level
 intr_enable (void) {
+	return enable (__builtin_return_address (0));
+}
+
+/* Enables interrupts on behalf of the code at PC and returns the
+   previous interrupt status. */
+static enum intr_level
+enable (void *pc) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		intr_off_end (pc);
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -156,9 +180,26 @@ intr_disable (void) {
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
 
+	if (old_level == INTR_ON)
+		intr_off_since = rdtsc ();
+
 	return old_level;
 }
 
+/* Ends the current interrupts-off window, which the code at PC
+   is about to close. */
+static void
+intr_off_end (void *pc) {
+	if (intr_off_since != 0) {
+		uint64_t off = rdtsc () - intr_off_since;
+		if (off > intr_off_max) {
+			intr_off_max = off;
+			intr_off_max_pc = pc;
+		}
+		intr_off_since = 0;
+	}
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -332,6 +373,11 @@ void
 intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
+	uint64_t start = rdtsc ();
+
+	/* An interrupt gate turned interrupts off on the way in. */
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		intr_off_since = start;
 
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
@@ -369,9 +415,17 @@ intr_handler (struct intr_frame *frame) {
 		in_external_intr = false;
 		pic_end_of_interrupt (frame->vec_no);
 
+		uint64_t run = rdtsc () - start;
+		if (run > handler_max[frame->vec_no - 0x20])
+			handler_max[frame->vec_no - 0x20] = run;
+
 		if (yield_on_return)
 			thread_yield ();
 	}
+
+	/* Returning will turn interrupts back on. */
+	if ((frame->eflags & FLAG_IF) && intr_get_level () == INTR_OFF)
+		intr_off_end (handler);
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
@@ -398,6 +452,22 @@ intr_dump_frame (const struct intr_frame *f) {
 			f->es, f->ds, f->cs, f->ss);
 }
 
+/* Prints the longest time interrupts were off, and the longest
+   time spent in each external interrupt handler. */
+void
+intr_print_stats (void) {
+	int i;
+
+	printf ("Interrupts: off at most %"PRIu64" cycles (%"PRId64" ns), "
+			"until %p\n", intr_off_max,
+			timer_cycles_to_ns (intr_off_max), intr_off_max_pc);
+	for (i = 0; i < 16; i++)
+		if (handler_max[i] != 0)
+			printf ("Interrupts: %s handler took at most %"PRIu64
+					" cycles (%"PRId64" ns)\n", intr_names[0x20 + i],
+					handler_max[i], timer_cycles_to_ns (handler_max[i]));
+}
+
 /* Returns the name of interrupt VEC. */
 const char *
 intr_name (uint8_t vec) {
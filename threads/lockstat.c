@@ -0,0 +1,158 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+
+/* Maximum number of lock classes. */
+#define LOCKSTAT_MAX 64
+
+/* -lockstat: Profile lock contention? */
+bool lockstat_enabled;
+
+/* Lock classes.  The first is shared by all unnamed locks. */
+static struct lockstat classes[LOCKSTAT_MAX] = {
+	{ .name = "(unnamed locks)" },
+};
+
+static void print_class (const struct lockstat *);
+
+/* Returns the class of locks, or of semaphores if SEMA is true,
+   named NAME, creating it if necessary.  Returns a null pointer,
+   so that the caller goes unprofiled, if there are too many
+   classes.  NAME must remain valid for as long as the kernel
+   runs. */
+struct lockstat *
+lockstat_register (const char *name, bool sema) {
+	struct lockstat *ls, *found = NULL;
+	enum intr_level old_level;
+
+	ASSERT (name != NULL);
+
+	old_level = intr_disable ();
+	for (ls = classes; ls < classes + LOCKSTAT_MAX; ls++) {
+		if (ls->name == NULL) {
+			ls->name = name;
+			ls->sema = sema;
+			found = ls;
+			break;
+		}
+		if (ls->sema == sema && !strcmp (ls->name, name)) {
+			found = ls;
+			break;
+		}
+	}
+	intr_set_level (old_level);
+	return found;
+}
+
+/* Records an acquisition of a lock or semaphore in class LS, or
+   of an unnamed lock if LS is null, from call site PC.  If
+   CONTENDED, the caller waited WAIT cycles for it. */
+void
+lockstat_acquired (struct lockstat *ls, bool contended, uint64_t wait,
+		void *pc) {
+	struct lockstat_site *site, *least;
+	enum intr_level old_level;
+
+	if (ls == NULL)
+		ls = &classes[0];
+
+	old_level = intr_disable ();
+	ls->acquisitions++;
+	if (contended) {
+		ls->contended++;
+		ls->wait_total += wait;
+		if (wait > ls->wait_max)
+			ls->wait_max = wait;
+	}
+
+	/* Find PC's site.  If it has none, take over the site with
+	   the fewest acquisitions, on the theory that a busy call
+	   site will soon win one back. */
+	least = &ls->sites[0];
+	for (site = ls->sites; site < ls->sites + LOCKSTAT_SITES; site++) {
+		if (site->pc == pc)
+			break;
+		if (site->acquisitions < least->acquisitions)
+			least = site;
+	}
+	if (site == ls->sites + LOCKSTAT_SITES) {
+		site = least;
+		memset (site, 0, sizeof *site);
+		site->pc = pc;
+	}
+	site->acquisitions++;
+	if (contended) {
+		site->contended++;
+		site->wait += wait;
+	}
+	intr_set_level (old_level);
+}
+
+/* Records that a lock in class LS, or an unnamed lock if LS is
+   null, was released after being held for HOLD cycles. */
+void
+lockstat_released (struct lockstat *ls, uint64_t hold) {
+	enum intr_level old_level;
+
+	if (ls == NULL)
+		ls = &classes[0];
+
+	old_level = intr_disable ();
+	ls->hold_total += hold;
+	if (hold > ls->hold_max)
+		ls->hold_max = hold;
+	intr_set_level (old_level);
+}
+
+/* Prints the classes that were used, most waited on first. */
+void
+lockstat_print_stats (void) {
+	bool printed[LOCKSTAT_MAX];
+	int i;
+
+	if (!lockstat_enabled)
+		return;
+
+	printf ("Lockstat: %-16s %10s %10s %14s %12s %14s %12s\n", "class",
+			"acquired", "contended", "wait cycles", "max wait",
+			"hold cycles", "max hold");
+	memset (printed, 0, sizeof printed);
+	for (;;) {
+		struct lockstat *best = NULL;
+
+		for (i = 0; i < LOCKSTAT_MAX; i++) {
+			struct lockstat *ls = &classes[i];
+			if (!printed[i] && ls->acquisitions > 0
+					&& (best == NULL || ls->wait_total > best->wait_total))
+				best = ls;
+		}
+		if (best == NULL)
+			break;
+		printed[best - classes] = true;
+		print_class (best);
+	}
+}
+
+/* Prints LS and its call sites. */
+static void
+print_class (const struct lockstat *ls) {
+	const struct lockstat_site *site;
+
+	printf ("Lockstat: %-16s %10lld %10lld %14llu %12llu ",
+			ls->name, ls->acquisitions, ls->contended,
+			(unsigned long long) ls->wait_total,
+			(unsigned long long) ls->wait_max);
+	if (ls->sema)
+		printf ("%14s %12s\n", "-", "-");
+	else
+		printf ("%14llu %12llu\n", (unsigned long long) ls->hold_total,
+				(unsigned long long) ls->hold_max);
+
+	for (site = ls->sites; site < ls->sites + LOCKSTAT_SITES; site++)
+		if (site->pc != NULL)
+			printf ("Lockstat:   %p %10lld %10lld %14llu\n", site->pc,
+					site->acquisitions, site->contended,
+					(unsigned long long) site->wait);
+}
@@ -11,35 +11,40 @@
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
-
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
-
-   When we free a block, we add it to its descriptor's free list.
-   But if the arena that the block was in now has no in-use
-   blocks, we remove all of the arena's blocks from the free list
-   and give the arena back to the page allocator.
-
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   The size of each request, in bytes, is rounded up to a "size
+   class" and assigned to the "descriptor" that manages blocks of
+   that size.  Up to 128 bytes the classes are 16 bytes apart;
+   above that, each power of 2 is split into 8 classes, so that
+   rounding never wastes more than 12.5% of a block.
+
+   Blocks are carved out of pages of memory, called "arenas",
+   obtained from the page allocator.  Each arena keeps its own
+   list of free blocks, and each descriptor keeps a list of its
+   arenas that have a free block.  A request is satisfied from the
+   first such arena; if there is none, a new arena is obtained
+   (if none is available, malloc() returns a null pointer).  A new
+   arena's blocks are handed out in order before any of them is
+   put on its free list, so setting it up takes constant time.
+
+   When we free a block, we add it to its arena's free list.  If
+   the arena now has no in-use blocks, we take it off its
+   descriptor's list and give it back to the page allocator, also
+   in constant time.
+
+   The arena header and the blocks must fit in one page, so a
+   class's blocks are made as large as the number of them that fit
+   in an arena allows, and classes that would fit the same number
+   are merged.  Blocks bigger than half an arena are handled by
+   allocating contiguous pages with the page allocator and sticking
+   the allocation size at the beginning of the allocated block's
+   arena header. */
 
 /* Descriptor. */
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
-	struct list free_list;      /* List of free blocks. */
-	struct lock lock;           /* Lock. */
+	struct list arenas;         /* Arenas with free blocks. */
+	struct hot_lock lock;       /* Lock. */
 };
 
 /* Magic number for detecting arena corruption. */
@@ -48,35 +53,84 @@ struct desc {
 /* Arena. */
 struct arena {
 	unsigned magic;             /* Always set to ARENA_MAGIC. */
+	unsigned unused_idx;        /* First block never handed out. */
 	struct desc *desc;          /* Owning descriptor, null for big block. */
 	size_t free_cnt;            /* Free blocks; pages in big block. */
+	struct block *free_list;    /* Free blocks below UNUSED_IDX. */
+	struct list_elem elem;      /* Element in descriptor's ARENAS. */
 };
 
 /* Free block. */
 struct block {
-	struct list_elem free_elem; /* Free list element. */
+	struct block *next;         /* Next free block in arena. */
 };
 
+/* Blocks are aligned to this many bytes, and the arena header is
+   padded to a multiple of it. */
+#define BLOCK_ALIGN 16
+#define ARENA_HEADER ROUND_UP (sizeof (struct arena), BLOCK_ALIGN)
+
+/* Largest block size, and number of BLOCK_ALIGN steps up to it. */
+#define MAX_BLOCK ((PGSIZE - ARENA_HEADER) / 2 / BLOCK_ALIGN * BLOCK_ALIGN)
+#define MAX_STEPS (MAX_BLOCK / BLOCK_ALIGN)
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[48];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Descriptor index for each size, in BLOCK_ALIGN steps. */
+static uint8_t size_class[MAX_STEPS + 1];
+
+/* Pages held by malloc(), in arenas and big blocks. */
+static size_t malloc_page_cnt;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static size_t next_class (size_t size);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
-
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
-		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+	size_t size, step;
+
+	for (size = BLOCK_ALIGN; size <= MAX_BLOCK; size = next_class (size)) {
+		size_t per_arena = (PGSIZE - ARENA_HEADER) / size;
+		size_t block_size = (PGSIZE - ARENA_HEADER) / per_arena
+			/ BLOCK_ALIGN * BLOCK_ALIGN;
+		struct desc *d;
+
+		/* Merge with the previous class if it holds as many
+		   blocks per arena. */
+		if (desc_cnt > 0 && descs[desc_cnt - 1].blocks_per_arena == per_arena)
+			d = &descs[desc_cnt - 1];
+		else {
+			d = &descs[desc_cnt++];
+			ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
+			list_init (&d->arenas);
+			hot_lock_init (&d->lock);
+			hot_lock_set_name (&d->lock, "malloc");
+		}
 		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
-		list_init (&d->free_list);
-		lock_init (&d->lock);
+		d->blocks_per_arena = per_arena;
 	}
+
+	/* Map each size to the smallest class that holds it. */
+	for (step = 0, size = 0; step <= MAX_STEPS; step++) {
+		while (descs[size].block_size < step * BLOCK_ALIGN)
+			size++;
+		size_class[step] = size;
+	}
+}
+
+/* Returns the size class after SIZE, before merging. */
+static size_t
+next_class (size_t size) {
+	size_t spacing = BLOCK_ALIGN;
+
+	/* Above 128 bytes, one eighth of the power of 2 below. */
+	while (spacing * 8 < size)
+		spacing *= 2;
+	return size + spacing;
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
@@ -91,58 +145,67 @@ malloc (size_t size) {
 	if (size == 0)
 		return NULL;
 
-	/* Find the smallest descriptor that satisfies a SIZE-byte
-	   request. */
-	for (d = descs; d < descs + desc_cnt; d++)
-		if (d->block_size >= size)
-			break;
-	if (d == descs + desc_cnt) {
+	if (size > MAX_BLOCK) {
 		/* SIZE is too big for any descriptor.
 		   Allocate enough pages to hold SIZE plus an arena. */
-		size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+		size_t page_cnt = DIV_ROUND_UP (size + ARENA_HEADER, PGSIZE);
 		a = palloc_get_multiple (0, page_cnt);
 		if (a == NULL)
 			return NULL;
+		__atomic_fetch_add (&malloc_page_cnt, page_cnt, __ATOMIC_RELAXED);
 
 		/* Initialize the arena to indicate a big block of PAGE_CNT
 		   pages, and return it. */
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
-		return a + 1;
+		return (uint8_t *) a + ARENA_HEADER;
 	}
 
-	lock_acquire (&d->lock);
+	/* Find the smallest descriptor that satisfies a SIZE-byte
+	   request. */
+	d = &descs[size_class[DIV_ROUND_UP (size, BLOCK_ALIGN)]];
 
-	/* If the free list is empty, create a new arena. */
-	if (list_empty (&d->free_list)) {
-		size_t i;
+	hot_lock_acquire (&d->lock);
 
+	/* If no arena has a free block, create a new arena. */
+	if (list_empty (&d->arenas)) {
 		/* Allocate a page. */
 		a = palloc_get_page (0);
 		if (a == NULL) {
-			lock_release (&d->lock);
+			hot_lock_release (&d->lock);
 			return NULL;
 		}
+		__atomic_fetch_add (&malloc_page_cnt, 1, __ATOMIC_RELAXED);
 
-		/* Initialize arena and add its blocks to the free list. */
+		/* Initialize arena, with all its blocks unused. */
 		a->magic = ARENA_MAGIC;
 		a->desc = d;
 		a->free_cnt = d->blocks_per_arena;
-		for (i = 0; i < d->blocks_per_arena; i++) {
-			struct block *b = arena_to_block (a, i);
-			list_push_back (&d->free_list, &b->free_elem);
-		}
+		a->free_list = NULL;
+		a->unused_idx = 0;
+		list_push_front (&d->arenas, &a->elem);
 	}
 
-	/* Get a block from free list and return it. */
-	b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-	a = block_to_arena (b);
-	a->free_cnt--;
-	lock_release (&d->lock);
+	/* Get a block from the first arena with one. */
+	a = list_entry (list_front (&d->arenas), struct arena, elem);
+	if (a->free_list != NULL) {
+		b = a->free_list;
+		a->free_list = b->next;
+	} else
+		b = arena_to_block (a, a->unused_idx++);
+	if (--a->free_cnt == 0)
+		list_remove (&a->elem);
+	hot_lock_release (&d->lock);
 	return b;
 }
 
+/* Returns the number of pages malloc() holds. */
+size_t
+malloc_pages (void) {
+	return __atomic_load_n (&malloc_page_cnt, __ATOMIC_RELAXED);
+}
+
 /* Allocates and return A times B bytes initialized to zeroes.
    Returns a null pointer if memory is not available. */
 void *
@@ -207,38 +270,43 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			bool empty;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
+			hot_lock_acquire (&d->lock);
 
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
+			/* Add block to its arena's free list.  An arena that
+			   was full gets a free block again. */
+			b->next = a->free_list;
+			a->free_list = b;
+			if (a->free_cnt++ == 0)
+				list_push_front (&d->arenas, &a->elem);
 
 			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
+			empty = a->free_cnt >= d->blocks_per_arena;
+			if (empty) {
 				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+				list_remove (&a->elem);
 			}
 
-			lock_release (&d->lock);
+			hot_lock_release (&d->lock);
+
+			if (empty) {
+				__atomic_fetch_sub (&malloc_page_cnt, 1, __ATOMIC_RELAXED);
+				palloc_free_page (a);
+			}
 		} else {
 			/* It's a big block.  Free its pages. */
+			__atomic_fetch_sub (&malloc_page_cnt, a->free_cnt, __ATOMIC_RELAXED);
 			palloc_free_multiple (a, a->free_cnt);
-			return;
 		}
 	}
 }
-
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
@@ -250,8 +318,8 @@ block_to_arena (struct block *b) {
 
 	/* Check that the block is properly aligned for the arena. */
 	ASSERT (a->desc == NULL
-			|| (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
-	ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
+			|| (pg_ofs (b) - ARENA_HEADER) % a->desc->block_size == 0);
+	ASSERT (a->desc != NULL || pg_ofs (b) == ARENA_HEADER);
 
 	return a;
 }
@@ -263,6 +331,6 @@ arena_to_block (struct arena *a, size_t idx) {
 	ASSERT (a->magic == ARENA_MAGIC);
 	ASSERT (idx < a->desc->blocks_per_arena);
 	return (struct block *) ((uint8_t *) a
-			+ sizeof *a
+			+ ARENA_HEADER
 			+ idx * a->desc->block_size);
 }
@@ -2,14 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,13 +27,98 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is a binary buddy allocator.  Its free memory is
+   kept as blocks of 2**ORDER pages, aligned to their size
+   relative to the pool base, on one free list per order.  A
+   request for N pages takes the smallest block of at least N
+   pages, splitting larger blocks as needed, and gives back the
+   pages it does not need.  A freed block merges with its buddy,
+   the other half of the block it was split from, whenever that
+   buddy is free too.  Both take O(log n) time.
+
+   The bitmap of used pages is only kept to cross-check the free
+   lists in debug builds.
+
+   In front of each pool is a magazine of free single pages, so
+   that most palloc_get_page() and palloc_free_page() calls only
+   turn interrupts off instead of taking the pool lock.  An empty
+   magazine is refilled, and a full one drained, MAG_BATCH pages
+   at a time under the lock.  MAG_SIZE bounds the memory the
+   magazine can hold back from the pool, and a multi-page request
+   gives the magazine back before it fails, since the cached pages
+   may complete a block.
+
+   Each pool also keeps a reserve of pages that are already filled
+   with zeros, so that a PAL_ZERO request for one page need not
+   clear it.  Whenever the reserve falls below half of
+   ZERO_RESERVE pages, the idle thread wakes a zeroing thread the
+   next time it would halt.  That thread takes free pages from the
+   pool, zeroes them and refills the reserve, and goes back to
+   sleep as soon as any other thread is ready, whatever the
+   scheduler thinks of its priority.  It leaves the last
+   ZERO_MIN_FREE free pages of the pool alone, and the reserve is
+   given back to the pool before any request fails for lack of
+   memory. */
+
+/* Number of block orders: the largest block is 2**(ORDER_CNT-1)
+   pages, or 1 GB. */
+#define ORDER_CNT 19
+
+/* Buddy allocator state of one page. */
+struct buddy_page {
+	struct list_elem elem;          /* Free list element. */
+	int8_t order;                   /* Order of the free block that this
+	                                   page heads, or -1. */
+};
+
+/* Magazine size and refill/drain batch, in pages. */
+#define MAG_SIZE 16
+#define MAG_BATCH 8
+
+/* A cache of free pages from one pool.  Only touched with
+   interrupts off. */
+struct magazine {
+	size_t cnt;                     /* Number of pages cached. */
+	void *pages[MAG_SIZE];          /* Cached pages, hottest last. */
+};
+
+/* Zeroed page reserve of each pool, in pages, and number of free
+   pages below which the reserve is not refilled. */
+#define ZERO_RESERVE 32
+#define ZERO_MIN_FREE (4 * ZERO_RESERVE)
+
+/* A block freed where the pool lock cannot be taken, waiting to
+   be merged by the next thread that holds it.  Stored in the
+   block itself. */
+struct deferred_free {
+	struct deferred_free *next;
+	size_t page_cnt;
+};
 
 /* A memory pool. */
 struct pool {
-	struct lock lock;               /* Mutual exclusion. */
-	struct bitmap *used_map;        /* Bitmap of free pages. */
+	struct hot_lock lock;           /* Mutual exclusion. */
+	struct bitmap *used_map;        /* Bitmap of used pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t page_cnt;                /* Number of pages in pool. */
+	struct buddy_page *pages;       /* State of each page. */
+	struct list free_lists[ORDER_CNT];  /* Free blocks of each order. */
+	size_t free_cnt[ORDER_CNT];     /* Number of blocks on each list. */
+	struct deferred_free *deferred; /* Frees not yet merged. */
+	struct magazine mag;            /* Page cache. */
+
+	/* Zeroed pages, each linked to the next through its first
+	   word.  Only touched with interrupts off. */
+	void **zeroed;                  /* Top of the stack, or null. */
+	size_t zeroed_cnt;              /* Number of pages on it. */
+
+	/* Statistics. */
+	long long mag_hits;             /* # of pages served by a magazine. */
+	long long mag_misses;           /* # of single-page requests that were not. */
+	long long zero_hits;            /* # of PAL_ZERO pages from the reserve. */
+	long long zero_misses;          /* # of PAL_ZERO pages cleared on request. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -38,10 +126,35 @@ static struct pool kernel_pool, user_pool;
 
 /* Maximum number of pages to put in user pool. */
 size_t user_page_limit = SIZE_MAX;
+
+/* -no-prezero: Zero PAL_ZERO pages only when they are allocated? */
+bool palloc_no_prezero;
+
+/* Zeroing thread, whether it is blocked waiting for the idle
+   thread to wake it, and whether a reserve wants refilling.  Only
+   touched with interrupts off. */
+static struct thread *zero_thread;
+static bool zero_waiting;
+static bool zero_requested;
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void buddy_init (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void drain_deferred (struct pool *);
+static void *mag_get (struct pool *);
+static void *mag_refill (struct pool *);
+static size_t mag_put (struct pool *, void *page, void *batch[MAG_BATCH]);
+static bool mag_flush (struct pool *);
+static void release_blocks (struct pool *, void *blocks[], size_t block_cnt,
+		size_t page_cnt);
+static size_t free_pages (const struct pool *);
+static void *zero_get (struct pool *);
+static bool zero_flush (struct pool *);
+static bool zero_fill (struct pool *);
+static thread_func zero_worker;
 
 /* multiboot info */
 struct multiboot_info {
@@ -189,6 +302,8 @@ populate_pools (struct area *base_mem, struct area *ext_mem) {
 
 	// generate the user pool
 	init_pool(&user_pool, &free_start, region_start, end);
+	hot_lock_set_name (&kernel_pool.lock, "kernel pool");
+	hot_lock_set_name (&user_pool.lock, "user pool");
 
 	// Iterate over the e820_entry. Setup the usable.
 	uint64_t usable_bound = (uint64_t) free_start;
@@ -219,7 +334,7 @@ split:
 			else
 				NOT_REACHED ();
 
-			pool_end = pool->base + bitmap_size (pool->used_map) * PGSIZE;
+			pool_end = pool->base + pool->page_cnt * PGSIZE;
 			page_idx = pg_no (start) - pg_no (pool->base);
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
@@ -232,6 +347,9 @@ split:
 			}
 		}
 	}
+
+	buddy_init (&kernel_pool);
+	buddy_init (&user_pool);
 }
 
 /* Initializes the page allocator and get the memory size */
@@ -253,6 +371,17 @@ palloc_init (void) {
 	return ext_mem.end;
 }
 
+/* Starts the thread that keeps the pools' reserves of zeroed
+   pages filled.  Must be called after thread_start(). */
+void
+palloc_start_zeroing (void) {
+	if (palloc_no_prezero)
+		return;
+	zero_requested = true;
+	if (thread_create ("zeroer", PRI_MIN, zero_worker, NULL) == TID_ERROR)
+		PANIC ("cannot start zeroer");
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -262,20 +391,53 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
+	bool zeroed = false;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
+	if (page_cnt == 1 && (flags & PAL_ZERO)) {
+		pages = zero_get (pool);
+		zeroed = pages != NULL;
+	}
+	if (pages == NULL && page_cnt == 1)
+		pages = mag_get (pool);
+	if (pages == NULL) {
+		hot_lock_acquire (&pool->lock);
+		drain_deferred (pool);
+		if (page_cnt == 1)
+			pages = mag_refill (pool);
+		else {
+			size_t page_idx = buddy_alloc (pool, page_cnt);
+			if (page_idx == BITMAP_ERROR) {
+				/* Give back the cached pages, which may merge into
+				   a block big enough, and try again. */
+				bool flushed = mag_flush (pool);
+				if (zero_flush (pool))
+					flushed = true;
+				if (flushed)
+					page_idx = buddy_alloc (pool, page_cnt);
+			}
+			if (page_idx != BITMAP_ERROR)
+				pages = pool->base + PGSIZE * page_idx;
+		}
+		hot_lock_release (&pool->lock);
+	}
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	/* Out of memory: fall back on the reserve. */
+	if (pages == NULL && page_cnt == 1) {
+		pages = zero_get (pool);
+		zeroed = pages != NULL;
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
-			memset (pages, 0, PGSIZE * page_cnt);
+		if (flags & PAL_ZERO) {
+			if (zeroed)
+				__atomic_fetch_add (&pool->zero_hits, 1, __ATOMIC_RELAXED);
+			else {
+				memset (pages, 0, PGSIZE * page_cnt);
+				__atomic_fetch_add (&pool->zero_misses, page_cnt,
+						__ATOMIC_RELAXED);
+			}
+		}
 	} else {
 		if (flags & PAL_ASSERT)
 			PANIC ("palloc_get: out of pages");
@@ -301,6 +463,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
 	size_t page_idx;
+	void *batch[MAG_BATCH];
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -314,12 +477,18 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 		NOT_REACHED ();
 
 	page_idx = pg_no (pages) - pg_no (pool->base);
+	ASSERT (page_idx + page_cnt <= pool->page_cnt);
 
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+
+	if (page_cnt == 1)
+		release_blocks (pool, batch, mag_put (pool, pages, batch), 1);
+	else {
+		batch[0] = pages;
+		release_blocks (pool, batch, 1, page_cnt);
+	}
 }
 
 /* Frees the page at PAGE. */
@@ -331,20 +500,32 @@ palloc_free_page (void *page) {
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
+  /* We'll put the pool's used_map and buddy state at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size. */
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
+	size_t buddy_pages = DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE)
+		* PGSIZE;
+	size_t i;
 
-	lock_init(&p->lock);
+	hot_lock_init (&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->page_cnt = pgcnt;
+	p->pages = *bm_base + bm_pages;
+	for (i = 0; i < ORDER_CNT; i++) {
+		list_init (&p->free_lists[i]);
+		p->free_cnt[i] = 0;
+	}
+	p->deferred = NULL;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = -1;
 
-	*bm_base += bm_pages;
+	*bm_base += bm_pages + buddy_pages;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -353,6 +534,426 @@ static bool
 page_from_pool (const struct pool *pool, void *page) {
 	size_t page_no = pg_no (page);
 	size_t start_page = pg_no (pool->base);
-	size_t end_page = start_page + bitmap_size (pool->used_map);
+	size_t end_page = start_page + pool->page_cnt;
 	return page_no >= start_page && page_no < end_page;
 }
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX in POOL on its
+   free list, without merging. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) {
+	pool->pages[page_idx].order = order;
+	list_push_front (&pool->free_lists[order], &pool->pages[page_idx].elem);
+	pool->free_cnt[order]++;
+}
+
+/* Takes the free block of 2**ORDER pages at PAGE_IDX in POOL off
+   its free list. */
+static void
+pop_block (struct pool *pool, size_t page_idx, int order) {
+	ASSERT (pool->pages[page_idx].order == order);
+
+	list_remove (&pool->pages[page_idx].elem);
+	pool->pages[page_idx].order = -1;
+	pool->free_cnt[order]--;
+}
+
+/* Builds POOL's free lists from the free pages in its used_map,
+   which populate_pools() has filled in. */
+static void
+buddy_init (struct pool *pool) {
+	size_t start = 0;
+
+	while (start < pool->page_cnt) {
+		size_t end;
+
+		start = bitmap_scan (pool->used_map, start, 1, false);
+		if (start == BITMAP_ERROR)
+			break;
+		end = bitmap_scan (pool->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = pool->page_cnt;
+
+		/* buddy_free() expects the pages to be marked used. */
+		bitmap_set_multiple (pool->used_map, start, end - start, true);
+		buddy_free (pool, start, end - start);
+		start = end;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL and returns the index
+   of the first, or BITMAP_ERROR if no block is large enough.  The
+   pool lock must be held. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	int order, k;
+	size_t page_idx;
+
+	if (page_cnt == 0 || page_cnt > ((size_t) 1 << (ORDER_CNT - 1)))
+		return BITMAP_ERROR;
+
+	/* Smallest order that fits, then smallest free block. */
+	for (order = 0; ((size_t) 1 << order) < page_cnt; order++)
+		continue;
+	for (k = order; k < ORDER_CNT; k++)
+		if (!list_empty (&pool->free_lists[k]))
+			break;
+	if (k == ORDER_CNT)
+		return BITMAP_ERROR;
+
+	page_idx = list_entry (list_front (&pool->free_lists[k]),
+			struct buddy_page, elem) - pool->pages;
+	pop_block (pool, page_idx, k);
+
+	/* Split off upper halves until the block is the right order. */
+	while (k > order) {
+		k--;
+		push_block (pool, page_idx + ((size_t) 1 << k), k);
+	}
+
+#ifndef NDEBUG
+	ASSERT (bitmap_none (pool->used_map, page_idx, (size_t) 1 << order));
+	bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << order, true);
+#endif
+
+	/* Give back the pages beyond PAGE_CNT. */
+	if (page_cnt < ((size_t) 1 << order))
+		buddy_free (pool, page_idx + page_cnt,
+				((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages at PAGE_IDX to POOL, as the largest
+   aligned blocks that cover them, merging each with its buddy
+   where possible.  The pool lock must be held, or interrupts off
+   during boot. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+#ifndef NDEBUG
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+#endif
+
+	while (page_cnt > 0) {
+		size_t idx = page_idx;
+		int order = 0;
+
+		while (order + 1 < ORDER_CNT
+				&& idx % ((size_t) 1 << (order + 1)) == 0
+				&& ((size_t) 1 << (order + 1)) <= page_cnt)
+			order++;
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+
+		/* Merge with free buddies. */
+		while (order + 1 < ORDER_CNT) {
+			size_t buddy = idx ^ ((size_t) 1 << order);
+			if (buddy >= pool->page_cnt || pool->pages[buddy].order != order)
+				break;
+			pop_block (pool, buddy, order);
+			idx &= ~((size_t) 1 << order);
+			order++;
+		}
+		push_block (pool, idx, order);
+	}
+}
+
+/* Returns the BLOCK_CNT blocks of PAGE_CNT pages in BLOCKS to
+   POOL. */
+static void
+release_blocks (struct pool *pool, void *blocks[], size_t block_cnt,
+		size_t page_cnt) {
+	size_t i;
+
+	if (block_cnt == 0)
+		return;
+
+	/* The scheduler frees the pages of dead threads with
+	   interrupts off, where it must not wait for the lock. */
+	if (intr_context () || intr_get_level () == INTR_OFF) {
+		for (i = 0; i < block_cnt; i++) {
+			struct deferred_free *d = blocks[i];
+			d->page_cnt = page_cnt;
+			d->next = pool->deferred;
+			pool->deferred = d;
+		}
+		return;
+	}
+
+	hot_lock_acquire (&pool->lock);
+	drain_deferred (pool);
+	for (i = 0; i < block_cnt; i++)
+		buddy_free (pool, pg_no (blocks[i]) - pg_no (pool->base), page_cnt);
+	hot_lock_release (&pool->lock);
+}
+
+/* Takes a page from POOL's magazine.  Returns a null
+   pointer if the magazine is empty. */
+static void *
+mag_get (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	struct magazine *m = &pool->mag;
+	void *page = NULL;
+
+	if (m->cnt > 0) {
+		page = m->pages[--m->cnt];
+		pool->mag_hits++;
+	} else
+		pool->mag_misses++;
+	intr_set_level (old_level);
+	return page;
+}
+
+/* Takes up to MAG_BATCH pages from POOL, returns one and puts the
+   others in its magazine.  Returns a null pointer if POOL is
+   empty.  The pool lock must be held. */
+static void *
+mag_refill (struct pool *pool) {
+	void *batch[MAG_BATCH];
+	size_t cnt, i;
+	struct magazine *m;
+	enum intr_level old_level;
+
+	for (cnt = 0; cnt < MAG_BATCH; cnt++) {
+		size_t page_idx = buddy_alloc (pool, 1);
+		if (page_idx == BITMAP_ERROR)
+			break;
+		batch[cnt] = pool->base + PGSIZE * page_idx;
+	}
+	if (cnt == 0)
+		return NULL;
+
+	old_level = intr_disable ();
+	m = &pool->mag;
+	for (i = 1; i < cnt && m->cnt < MAG_SIZE; i++)
+		m->pages[m->cnt++] = batch[i];
+	intr_set_level (old_level);
+
+	/* Another thread refilled the magazine while we waited for
+	   the lock. */
+	for (; i < cnt; i++)
+		buddy_free (pool, pg_no (batch[i]) - pg_no (pool->base), 1);
+	return batch[0];
+}
+
+/* Puts PAGE in POOL's magazine.  If the magazine is full, first
+   moves its MAG_BATCH coldest pages into BATCH, for the caller to
+   release, and returns their number; otherwise returns 0. */
+static size_t
+mag_put (struct pool *pool, void *page, void *batch[MAG_BATCH]) {
+	enum intr_level old_level = intr_disable ();
+	struct magazine *m = &pool->mag;
+	size_t cnt = 0;
+
+	if (m->cnt == MAG_SIZE) {
+		cnt = MAG_BATCH;
+		memcpy (batch, m->pages, sizeof *batch * MAG_BATCH);
+		memmove (m->pages, m->pages + MAG_BATCH,
+				sizeof *m->pages * (MAG_SIZE - MAG_BATCH));
+		m->cnt -= MAG_BATCH;
+	}
+	m->pages[m->cnt++] = page;
+	intr_set_level (old_level);
+	return cnt;
+}
+
+/* Returns every page in POOL's magazine to its free lists.
+   Returns true if there were any.  The pool lock must be held. */
+static bool
+mag_flush (struct pool *pool) {
+	void *pages[MAG_SIZE];
+	size_t cnt, i;
+	struct magazine *m;
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	m = &pool->mag;
+	cnt = m->cnt;
+	memcpy (pages, m->pages, sizeof *pages * cnt);
+	m->cnt = 0;
+	intr_set_level (old_level);
+
+	for (i = 0; i < cnt; i++)
+		buddy_free (pool, pg_no (pages[i]) - pg_no (pool->base), 1);
+	return cnt > 0;
+}
+
+/* Merges the blocks freed into POOL while its lock could not be
+   taken.  The pool lock must be held. */
+static void
+drain_deferred (struct pool *pool) {
+	struct deferred_free *d;
+	enum intr_level old_level;
+
+	if (pool->deferred == NULL)
+		return;
+
+	old_level = intr_disable ();
+	d = pool->deferred;
+	pool->deferred = NULL;
+	intr_set_level (old_level);
+
+	while (d != NULL) {
+		struct deferred_free *next = d->next;
+		buddy_free (pool, pg_no (d) - pg_no (pool->base), d->page_cnt);
+		d = next;
+	}
+}
+
+/* Returns the number of pages on POOL's free lists.  The pool
+   lock must be held. */
+static size_t
+free_pages (const struct pool *pool) {
+	size_t cnt = 0;
+	int order;
+
+	for (order = 0; order < ORDER_CNT; order++)
+		cnt += pool->free_cnt[order] << order;
+	return cnt;
+}
+
+/* Takes a zeroed page from POOL's reserve, and asks for the
+   reserve to be refilled at the next idle moment if it runs low.
+   Never wakes or yields to another thread, so it is safe anywhere
+   palloc_get_page() is.  Returns a null pointer if the reserve is
+   empty. */
+static void *
+zero_get (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	void **page = pool->zeroed;
+
+	if (page != NULL) {
+		pool->zeroed = *page;
+		pool->zeroed_cnt--;
+		*page = NULL;
+	}
+	if (pool->zeroed_cnt < ZERO_RESERVE / 2)
+		zero_requested = true;
+	intr_set_level (old_level);
+	return page;
+}
+
+/* Returns every page in POOL's reserve to its free lists.
+   Returns true if there were any.  The pool lock must be held. */
+static bool
+zero_flush (struct pool *pool) {
+	enum intr_level old_level = intr_disable ();
+	void **page = pool->zeroed;
+
+	pool->zeroed = NULL;
+	pool->zeroed_cnt = 0;
+	intr_set_level (old_level);
+
+	if (page == NULL)
+		return false;
+	while (page != NULL) {
+		void **next = *page;
+		buddy_free (pool, pg_no (page) - pg_no (pool->base), 1);
+		page = next;
+	}
+	return true;
+}
+
+/* Fills POOL's reserve with ZERO_RESERVE zeroed pages, or as many
+   as it can spare.  Stops early, returning false, if another
+   thread becomes ready. */
+static bool
+zero_fill (struct pool *pool) {
+	while (pool->zeroed_cnt < ZERO_RESERVE) {
+		void **page = NULL;
+		enum intr_level old_level;
+
+		if (thread_others_ready ())
+			return false;
+
+		hot_lock_acquire (&pool->lock);
+		drain_deferred (pool);
+		if (free_pages (pool) > ZERO_MIN_FREE) {
+			size_t page_idx = buddy_alloc (pool, 1);
+			if (page_idx != BITMAP_ERROR)
+				page = (void **) (pool->base + PGSIZE * page_idx);
+		}
+		hot_lock_release (&pool->lock);
+		if (page == NULL)
+			break;
+
+		memset (page, 0, PGSIZE);
+
+		old_level = intr_disable ();
+		*page = pool->zeroed;
+		pool->zeroed = page;
+		pool->zeroed_cnt++;
+		intr_set_level (old_level);
+	}
+	return true;
+}
+
+/* Called by the idle thread, with interrupts off, before it
+   halts.  Wakes the zeroing thread if a reserve wants refilling.
+   Returns true if it did, in which case the idle thread should
+   let it run instead of halting. */
+bool
+palloc_idle (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!zero_waiting || !zero_requested)
+		return false;
+	zero_waiting = false;
+	zero_requested = false;
+	thread_unblock (zero_thread);
+	return true;
+}
+
+/* Zeroing thread: refills both reserves each time the idle
+   thread wakes it.  Under the MLFQS or CFS its priority is not
+   fixed, so rather than rely on it, it checks after each page
+   whether another thread is ready, and if so leaves the rest for
+   the next idle moment. */
+static void
+zero_worker (void *aux UNUSED) {
+	if (thread_mlfqs || thread_cfs)
+		thread_set_nice (19);
+
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		zero_thread = thread_current ();
+		zero_waiting = true;
+		thread_block ();
+		intr_set_level (old_level);
+
+		if (!zero_fill (&kernel_pool) || !zero_fill (&user_pool)) {
+			old_level = intr_disable ();
+			zero_requested = true;
+			intr_set_level (old_level);
+		}
+	}
+}
+
+/* Prints the free pages of POOL, named NAME, and its number of
+   free blocks of each order. */
+static void
+print_pool_stats (struct pool *pool, const char *name) {
+	int order;
+
+	hot_lock_acquire (&pool->lock);
+	drain_deferred (pool);
+	printf ("%s pool: %zu of %zu pages free, free blocks by order:",
+			name, free_pages (pool), pool->page_cnt);
+	for (order = 0; order < ORDER_CNT; order++)
+		if (pool->free_cnt[order] != 0)
+			printf (" %d:%zu", order, pool->free_cnt[order]);
+	printf ("\n");
+	printf ("%s pool: %zu pages in magazines, %lld hits, %lld misses\n",
+			name, pool->mag.cnt, pool->mag_hits, pool->mag_misses);
+	printf ("%s pool: %zu zeroed pages in reserve, "
+			"%lld zero-fills avoided, %lld done on request\n",
+			name, pool->zeroed_cnt, pool->zero_hits, pool->zero_misses);
+	hot_lock_release (&pool->lock);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+	print_pool_stats (&kernel_pool, "Kernel");
+	print_pool_stats (&user_pool, "User");
+}
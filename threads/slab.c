@@ -0,0 +1,221 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Header at the start of each slab page.  The objects follow it. */
+struct slab {
+	unsigned magic;             /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;   /* Owning cache. */
+	struct list_elem elem;      /* Element in partial or full list. */
+	size_t inuse;               /* Number of objects handed out. */
+	void *free;                 /* First free object, or null. */
+};
+
+/* Offset of the first object in a slab. */
+#define SLAB_HEADER ROUND_UP (sizeof (struct slab), sizeof (void *))
+
+/* All caches, for statistics. */
+#define CACHE_MAX 16
+static struct kmem_cache *caches[CACHE_MAX];
+static size_t cache_cnt;
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+
+/* Returns a pointer to the free list link of free object OBJ in
+   cache C. */
+static inline void **
+free_link (const struct kmem_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/* Initializes cache C, named NAME, to hand out objects of SIZE
+   bytes.  If CTOR is nonnull, it constructs each object when its
+   slab is created. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+		kmem_ctor *ctor) {
+	enum intr_level old_level;
+
+	ASSERT (c != NULL);
+	ASSERT (name != NULL);
+	ASSERT (size > 0);
+
+	c->name = name;
+	c->size = size;
+	c->ctor = ctor;
+
+	/* A free object's link normally overlays its contents, but
+	   must not overwrite a constructed object, so then it goes
+	   after the object. */
+	c->stride = ROUND_UP (size, sizeof (void *));
+	if (ctor != NULL) {
+		c->link_ofs = c->stride;
+		c->stride += sizeof (void *);
+	} else
+		c->link_ofs = 0;
+	ASSERT (c->stride <= PGSIZE - SLAB_HEADER);
+	c->objs_per_slab = (PGSIZE - SLAB_HEADER) / c->stride;
+
+	hot_lock_init (&c->lock);
+	hot_lock_set_name (&c->lock, name);
+	list_init (&c->partial);
+	list_init (&c->full);
+	c->empty = NULL;
+	c->allocs = c->frees = 0;
+	c->slab_cnt = c->slab_max = 0;
+
+	old_level = intr_disable ();
+	ASSERT (cache_cnt < CACHE_MAX);
+	caches[cache_cnt++] = c;
+	intr_set_level (old_level);
+}
+
+/* Allocates an object from cache C.  Returns a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	hot_lock_acquire (&c->lock);
+	if (!list_empty (&c->partial))
+		s = list_entry (list_front (&c->partial), struct slab, elem);
+	else {
+		if (c->empty != NULL) {
+			s = c->empty;
+			c->empty = NULL;
+		} else {
+			s = slab_create (c);
+			if (s == NULL) {
+				hot_lock_release (&c->lock);
+				return NULL;
+			}
+		}
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	obj = s->free;
+	s->free = *free_link (c, obj);
+	if (++s->inuse == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	c->allocs++;
+	hot_lock_release (&c->lock);
+	return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  A null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	struct slab *s, *release = NULL;
+
+	if (obj == NULL)
+		return;
+
+	s = obj_to_slab (c, obj);
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   it must stay constructed. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->size);
+#endif
+
+	hot_lock_acquire (&c->lock);
+	ASSERT (s->inuse > 0);
+	*free_link (c, obj) = s->free;
+	s->free = obj;
+	if (s->inuse-- == c->objs_per_slab) {
+		/* Full to partial. */
+		list_remove (&s->elem);
+		list_push_front (&c->partial, &s->elem);
+	}
+	if (s->inuse == 0) {
+		/* Keep one empty slab, so that a cache that hovers around
+		   a slab boundary does not go to the page allocator for
+		   every other call. */
+		list_remove (&s->elem);
+		if (c->empty == NULL)
+			c->empty = s;
+		else {
+			release = s;
+			c->slab_cnt--;
+		}
+	}
+	c->frees++;
+	hot_lock_release (&c->lock);
+
+	if (release != NULL)
+		palloc_free_page (release);
+}
+
+/* Prints statistics for every cache. */
+void
+kmem_print_stats (void) {
+	size_t i;
+
+	for (i = 0; i < cache_cnt; i++) {
+		const struct kmem_cache *c = caches[i];
+		printf ("Slab: %s: %zu-byte objects, %zu per slab, "
+				"%lld in use, %zu slabs (max %zu), %lld allocs\n",
+				c->name, c->size, c->objs_per_slab, c->allocs - c->frees,
+				c->slab_cnt, c->slab_max, c->allocs);
+	}
+}
+
+/* Creates a new slab for cache C, with all of its objects free
+   and constructed.  Returns a null pointer if memory is not
+   available.  C's lock must be held. */
+static struct slab *
+slab_create (struct kmem_cache *c) {
+	struct slab *s;
+	size_t i;
+
+	s = palloc_get_page (0);
+	if (s == NULL)
+		return NULL;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->inuse = 0;
+	s->free = NULL;
+
+	/* Link the objects in address order. */
+	for (i = c->objs_per_slab; i-- > 0; ) {
+		void *obj = (uint8_t *) s + SLAB_HEADER + i * c->stride;
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*free_link (c, obj) = s->free;
+		s->free = obj;
+	}
+
+	if (++c->slab_cnt > c->slab_max)
+		c->slab_max = c->slab_cnt;
+	return s;
+}
+
+/* Returns the slab that object OBJ of cache C is in. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	/* Check that the slab is valid and that OBJ is properly
+	   aligned for it. */
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT (pg_ofs (obj) >= SLAB_HEADER);
+	ASSERT ((pg_ofs (obj) - SLAB_HEADER) % c->stride == 0);
+
+	return s;
+}
@@ -30,12 +30,35 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
-
-/* Add */
-bool cond_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
-bool sema_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
-void print_waiter_list(struct semaphore *sema);
+#include "threads/trace.h"
+#include "intrinsic.h"
+
+static pheap_less_func sema_waiter_less;
+static pheap_less_func cond_waiter_less;
+static struct rwlock_hold *rwlock_find_hold (struct thread *,
+		const struct rwlock *);
+static void rwlock_prepare (struct rwlock *);
+static struct rwlock_hold *rwlock_hold_alloc (void);
+static void rwlock_hold_free (struct rwlock_hold *);
+static void rwlock_grant (struct rwlock *, struct thread *, bool write);
+static struct rwlock_hold *rwlock_drop (struct rwlock *);
+static void rwlock_hand_off (struct rwlock *);
+static void rwlock_wait (struct semaphore *);
+static void rwlock_wake (struct semaphore *);
+static int top_waiter_priority (const struct semaphore *);
+
+/* Stamps waiters so that those of equal priority are woken in
+   the order they started waiting. */
+static uint64_t next_wait_seq;
+
+/* Holds handed out when malloc() fails, so that a thread short
+   of memory still receives donations through its rwlocks. */
+#define RWLOCK_HOLD_RESERVE 16
+static struct rwlock_hold hold_reserve[RWLOCK_HOLD_RESERVE];
+static bool hold_reserve_used[RWLOCK_HOLD_RESERVE];
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -51,7 +74,17 @@ sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 
 	sema->value = value;
-	list_init (&sema->waiters);
+	pheap_init (&sema->waiters, sema_waiter_less, NULL);
+	sema->stat = NULL;
+}
+
+/* Names SEMA for the lock profiler.  Semaphores of the same name
+   are profiled together. */
+void
+sema_set_name (struct semaphore *sema, const char *name) {
+	ASSERT (sema != NULL);
+
+	sema->stat = lockstat_register (name, true);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -65,17 +98,27 @@ sema_init (struct semaphore *sema, unsigned value) {
 void
 sema_down (struct semaphore *sema) {
 	enum intr_level old_level;
+	bool contended;
+	uint64_t start = 0;
 
 	ASSERT (sema != NULL);
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();
+	contended = sema->value == 0;
+	if (__builtin_expect (lockstat_enabled, 0) && sema->stat != NULL)
+		start = rdtsc ();
 	while (sema->value == 0) {
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		list_insert_ordered (&sema->waiters, &thread_current ()->elem, sema_high_priority, NULL);
+		struct thread *t = thread_current ();
+		t->wait_seq = next_wait_seq++;
+		t->blocked_sema = sema;
+		pheap_insert (&sema->waiters, &t->wait_elem);
 		thread_block ();
 	}
 	sema->value--;
+	if (start != 0)
+		lockstat_acquired (sema->stat, contended, rdtsc () - start,
+				__builtin_return_address (0));
 	intr_set_level (old_level);
 }
 
@@ -115,16 +158,47 @@ sema_up (struct semaphore *sema) {
 	ASSERT (sema != NULL);
 
 	old_level = intr_disable ();
-	if (!list_empty (&sema->waiters)){
-		list_sort(&sema->waiters, sema_high_priority, NULL);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
-		}
+	if (!pheap_empty (&sema->waiters)) {
+		struct thread *t = pheap_entry (pheap_pop_max (&sema->waiters),
+				struct thread, wait_elem);
+		t->blocked_sema = NULL;
+		thread_unblock (t);
+	}
 	sema->value++;
 	check_priority();
 	intr_set_level (old_level);
 }
 
+/* Like sema_up(), but switches straight to the thread it wakes,
+   if any, handing it the rest of the current time slice instead
+   of leaving it to the scheduler.  Meant for a waker that will
+   block soon anyway, such as one side of a request/response
+   exchange, so that the other side runs without a trip through
+   the run queue.  The woken thread is not run ahead of the
+   waker or a ready thread of higher priority.
+
+   This function must not be called within an interrupt handler. */
+void
+sema_up_and_yield_to (struct semaphore *sema) {
+	struct thread *t = NULL;
+	enum intr_level old_level;
+
+	ASSERT (sema != NULL);
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (!pheap_empty (&sema->waiters)) {
+		t = pheap_entry (pheap_pop_max (&sema->waiters),
+				struct thread, wait_elem);
+		t->blocked_sema = NULL;
+		thread_unblock (t);
+	}
+	sema->value++;
+	if (t != NULL)
+		thread_yield_to (t);
+	intr_set_level (old_level);
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -180,7 +254,19 @@ lock_init (struct lock *lock) {
 	ASSERT (lock != NULL);
 
 	lock->holder = NULL;
+	lock->priority = PRI_MIN - 1;
 	sema_init (&lock->semaphore, 1);
+	lock->stat = NULL;
+	lock->acquired_tsc = 0;
+}
+
+/* Names LOCK for the lock profiler.  Locks of the same name are
+   profiled together. */
+void
+lock_set_name (struct lock *lock, const char *name) {
+	ASSERT (lock != NULL);
+
+	lock->stat = lockstat_register (name, false);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -198,7 +284,13 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	struct thread *t = thread_current();
+	struct thread *holder = lock->holder;
+	uint64_t start = 0;
 
+	if (__builtin_expect (lockstat_enabled, 0))
+		start = rdtsc ();
+	if (holder != NULL)
+		TRACE (TRACE_LOCK_WAIT, t->tid, holder->tid, (intptr_t) lock);
 	if (!thread_mlfqs) {
 		if (lock->holder) {
 			t->wait_on_lock = lock;
@@ -207,8 +299,17 @@ lock_acquire (struct lock *lock) {
 	}
 
 	sema_down (&lock->semaphore);
+	if (holder != NULL)
+		TRACE (TRACE_LOCK_ACQUIRE, t->tid, 0, (intptr_t) lock);
 	t->wait_on_lock = NULL;
 	lock->holder = t;
+	if (!thread_mlfqs)
+		add_with_lock (lock);
+	if (start != 0) {
+		lock->acquired_tsc = rdtsc ();
+		lockstat_acquired (lock->stat, holder != NULL,
+				lock->acquired_tsc - start, __builtin_return_address (0));
+	}
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -225,8 +326,16 @@ lock_try_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	success = sema_try_down (&lock->semaphore);
-	if (success)
+	if (success) {
 		lock->holder = thread_current ();
+		if (!thread_mlfqs)
+			add_with_lock (lock);
+		if (__builtin_expect (lockstat_enabled, 0)) {
+			lock->acquired_tsc = rdtsc ();
+			lockstat_acquired (lock->stat, false, 0,
+					__builtin_return_address (0));
+		}
+	}
 	return success;
 }
 
@@ -241,12 +350,15 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
-	lock->holder = NULL;
-
+	if (lock->acquired_tsc != 0) {
+		lockstat_released (lock->stat, rdtsc () - lock->acquired_tsc);
+		lock->acquired_tsc = 0;
+	}
 	if (!thread_mlfqs) {
 		remove_with_lock(lock);
 		refresh_priority();
 	}
+	lock->holder = NULL;
 	sema_up (&lock->semaphore);
 }
 
@@ -260,10 +372,121 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* Maximum number of times mutex_acquire() polls a mutex whose
+   holder is running elsewhere, and yields to a holder that is
+   ready here, before parking. */
+#define MUTEX_SPIN_LIMIT 1000
+#define MUTEX_YIELD_LIMIT 2
+
+static bool mutex_yield_to_holder (struct lock *);
+
+/* Initializes mutex M, which is not held by any thread. */
+void
+mutex_init (struct mutex *m) {
+	ASSERT (m != NULL);
+
+	lock_init (&m->lock);
+}
+
+/* Names M for the lock profiler, as lock_set_name(). */
+void
+mutex_set_name (struct mutex *m, const char *name) {
+	ASSERT (m != NULL);
+
+	lock_set_name (&m->lock, name);
+}
+
+/* Acquires M, waiting for it to become available if necessary.
+   The mutex must not already be held by the current thread.
+
+   While the holder is running on another CPU it should release M
+   shortly, so we spin.  While it is preempted on this CPU we lend
+   it our priority and run it directly.  Only when neither helps,
+   because the holder is blocked or we have run out of patience,
+   do we sleep in lock_acquire(). */
+void
+mutex_acquire (struct mutex *m) {
+	struct lock *lock = &m->lock;
+	int spins = 0, yields = 0;
+
+	ASSERT (m != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (!lock_held_by_current_thread (lock));
+
+	while (!lock_try_acquire (lock)) {
+		struct thread *holder = lock->holder;
+
+		if (holder == NULL || holder->status == THREAD_RUNNING) {
+			/* Released but not yet upped, or running elsewhere. */
+			if (++spins > MUTEX_SPIN_LIMIT)
+				break;
+			asm volatile ("pause" : : : "memory");
+		} else if (yields++ >= MUTEX_YIELD_LIMIT
+				|| !mutex_yield_to_holder (lock))
+			break;
+	}
+	if (!lock_held_by_current_thread (lock))
+		lock_acquire (lock);
+}
+
+/* Tries to acquire M and returns true if successful or false on
+   failure, without spinning or sleeping. */
+bool
+mutex_try_acquire (struct mutex *m) {
+	ASSERT (m != NULL);
+
+	return lock_try_acquire (&m->lock);
+}
+
+/* Releases M, which must be held by the current thread. */
+void
+mutex_release (struct mutex *m) {
+	ASSERT (m != NULL);
+
+	lock_release (&m->lock);
+}
+
+/* Returns true if the current thread holds M, false otherwise. */
+bool
+mutex_held_by_current_thread (const struct mutex *m) {
+	ASSERT (m != NULL);
+
+	return lock_held_by_current_thread (&m->lock);
+}
+
+/* If LOCK's holder is ready to run on this CPU, donates our
+   priority to it as lock_acquire() would and yields to it.
+   Returns false, without yielding, if the holder is not ready.
+
+   The donation is left in place on return.  It is retracted when
+   the holder releases LOCK or, if we go on to sleep, renewed by
+   lock_acquire(). */
+static bool
+mutex_yield_to_holder (struct lock *lock) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+	struct thread *holder = lock->holder;
+	bool yielded = false;
+
+	if (holder != NULL && holder->status == THREAD_READY) {
+		if (!thread_mlfqs) {
+			t->wait_on_lock = lock;
+			donate_priority ();
+			t->wait_on_lock = NULL;
+		}
+		thread_yield_to (holder);
+		yielded = true;
+	}
+	intr_set_level (old_level);
+	return yielded;
+}
+
+/* One semaphore in a condition variable's waiter heap. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct pheap_elem elem;             /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
+	uint64_t seq;                       /* Orders waiters of equal priority. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -273,7 +496,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	pheap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -299,6 +522,7 @@ cond_init (struct condition *cond) {
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -306,8 +530,17 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	// list_push_back (&cond->waiters, &waiter.elem);
-	list_insert_ordered (&cond->waiters, &waiter.elem, cond_high_priority, NULL);
+	waiter.thread = thread_current ();
+
+	/* Donation may reorder the heap from another thread's context,
+	   so heap updates are made with interrupts off. */
+	old_level = intr_disable ();
+	waiter.seq = next_wait_seq++;
+	pheap_insert (&cond->waiters, &waiter.elem);
+	waiter.thread->blocked_cond = cond;
+	waiter.thread->blocked_cond_elem = &waiter.elem;
+	intr_set_level (old_level);
+
 	lock_release (lock);
 	sema_down (&waiter.semaphore);
 	lock_acquire (lock);
@@ -327,11 +560,18 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (!intr_context ());
 	ASSERT (lock_held_by_current_thread (lock));
 
-	if (!list_empty (&cond->waiters)){
-		list_sort(&cond->waiters, cond_high_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level = intr_disable ();
+	if (!pheap_empty (&cond->waiters)) {
+		waiter = pheap_entry (pheap_pop_max (&cond->waiters),
+				struct semaphore_elem, elem);
+		waiter->thread->blocked_cond = NULL;
+		waiter->thread->blocked_cond_elem = NULL;
 	}
+	intr_set_level (old_level);
+
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -345,38 +585,374 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!pheap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
 
-bool sema_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux) {
-    const struct thread *priority_a = list_entry(a, struct thread, elem);
-    const struct thread *priority_b = list_entry(b, struct thread, elem);
-    return priority_a->priority > priority_b->priority;
+/* Initializes RW as a reader-writer lock held by no thread.  If
+   PREFER_WRITERS is true, readers do not acquire RW while a
+   writer waits for it. */
+void
+rwlock_init (struct rwlock *rw, bool prefer_writers) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	list_init (&rw->holds);
+	sema_init (&rw->read_waiters, 0);
+	sema_init (&rw->write_waiters, 0);
+	rw->prefer_writers = prefer_writers;
+}
+
+/* Acquires RW for reading, sleeping until no writer holds it
+   and, with writer preference, none waits for it.  The current
+   thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rwlock_find_hold (t, rw) == NULL);
+
+	rwlock_prepare (rw);
+	old_level = intr_disable ();
+	if (rw->writer == NULL && (!rw->prefer_writers
+				|| pheap_empty (&rw->write_waiters.waiters)))
+		rwlock_grant (rw, t, false);
+	else {
+		rwlock_find_hold (t, rw)->waiting = true;
+		if (!thread_mlfqs)
+			donate_priority ();
+		rwlock_wait (&rw->read_waiters);
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading. */
+void
+rwlock_release_read (struct rwlock *rw) {
+	struct rwlock_hold *h;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rw->readers > 0);
+	ASSERT (!rwlock_write_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+	h = rwlock_drop (rw);
+	rw->readers--;
+	rwlock_hand_off (rw);
+	intr_set_level (old_level);
+	rwlock_hold_free (h);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rwlock_find_hold (t, rw) == NULL);
+
+	rwlock_prepare (rw);
+	old_level = intr_disable ();
+	if (rw->writer == NULL && rw->readers == 0)
+		rwlock_grant (rw, t, true);
+	else {
+		rwlock_find_hold (t, rw)->waiting = true;
+		if (!thread_mlfqs)
+			donate_priority ();
+		rwlock_wait (&rw->write_waiters);
+	}
+	intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing. */
+void
+rwlock_release_write (struct rwlock *rw) {
+	struct rwlock_hold *h;
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (rwlock_write_held_by_current_thread (rw));
+
+	old_level = intr_disable ();
+	h = rwlock_drop (rw);
+	rw->writer = NULL;
+	rwlock_hand_off (rw);
+	intr_set_level (old_level);
+	rwlock_hold_free (h);
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_write_held_by_current_thread (const struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	return rw->writer == thread_current ();
+}
+
+/* Returns T's hold on RW, or a null pointer if it has none. */
+static struct rwlock_hold *
+rwlock_find_hold (struct thread *t, const struct rwlock *rw) {
+	struct list_elem *e;
+
+	for (e = list_begin (&t->rw_holds); e != list_end (&t->rw_holds);
+			e = list_next (e)) {
+		struct rwlock_hold *h = list_entry (e, struct rwlock_hold,
+				thread_elem);
+		if (h->rwlock == rw)
+			return h;
+	}
+	return NULL;
+}
+
+/* Returns the rwlock T is blocked on, or a null pointer if it
+   is not blocked on one.  Interrupts must be off. */
+struct rwlock *
+rwlock_waited_on (struct thread *t) {
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	for (e = list_begin (&t->rw_holds); e != list_end (&t->rw_holds);
+			e = list_next (e)) {
+		struct rwlock_hold *h = list_entry (e, struct rwlock_hold,
+				thread_elem);
+		if (h->waiting)
+			return h->rwlock;
+	}
+	return NULL;
+}
+
+/* Gives the current thread a hold for RW, ready for
+   rwlock_grant() to fill in, whether the thread gets RW at once
+   or is granted it later by a releasing thread.  Must be called
+   with interrupts on, since it may allocate. */
+static void
+rwlock_prepare (struct rwlock *rw) {
+	struct thread *t = thread_current ();
+	struct rwlock_hold *h = rwlock_hold_alloc ();
+	enum intr_level old_level;
+
+	h->rwlock = rw;
+	h->waiting = false;
+	h->lock.holder = NULL;
+	h->lock.priority = PRI_MIN;
+	old_level = intr_disable ();
+	list_push_back (&t->rw_holds, &h->thread_elem);
+	intr_set_level (old_level);
+}
+
+/* Allocates a hold, from the reserve if malloc() fails.  Panics
+   if the reserve is used up too. */
+static struct rwlock_hold *
+rwlock_hold_alloc (void) {
+	struct rwlock_hold *h = malloc (sizeof *h);
+	enum intr_level old_level;
+	int i;
+
+	if (h != NULL)
+		return h;
+
+	old_level = intr_disable ();
+	for (i = 0; i < RWLOCK_HOLD_RESERVE && h == NULL; i++)
+		if (!hold_reserve_used[i]) {
+			hold_reserve_used[i] = true;
+			h = &hold_reserve[i];
+		}
+	intr_set_level (old_level);
+	if (h == NULL)
+		PANIC ("rwlock: out of memory for holds");
+	return h;
+}
+
+/* Frees H, allocated by rwlock_hold_alloc(). */
+static void
+rwlock_hold_free (struct rwlock_hold *h) {
+	if (h >= hold_reserve && h < hold_reserve + RWLOCK_HOLD_RESERVE)
+		hold_reserve_used[h - hold_reserve] = false;
+	else
+		free (h);
 }
 
-bool cond_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux) {
-    struct semaphore_elem *sa = list_entry(a, struct semaphore_elem, elem);
-	struct semaphore_elem *sb = list_entry(b, struct semaphore_elem, elem);
-	
-	if (list_empty(&sa->semaphore.waiters) || list_empty(&sb->semaphore.waiters))
-		return false;
-    struct thread *thread_a = list_entry(list_front(&sa->semaphore.waiters), struct thread, elem);
-    struct thread *thread_b = list_entry(list_front(&sb->semaphore.waiters), struct thread, elem);
+/* Makes T a reader of RW, or its writer if WRITE is true.  The
+   new hold inherits the donations of the threads still waiting.
+   Interrupts must be off. */
+static void
+rwlock_grant (struct rwlock *rw, struct thread *t, bool write) {
+	struct rwlock_hold *h = rwlock_find_hold (t, rw);
+	int priority;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (h != NULL);
 
-    return thread_a->priority > thread_b->priority;
+	if (write)
+		rw->writer = t;
+	else
+		rw->readers++;
+	h->waiting = false;
+	h->lock.holder = t;
+	list_push_back (&rw->holds, &h->elem);
+	if (!thread_mlfqs) {
+		priority = top_waiter_priority (&rw->read_waiters);
+		if (priority < top_waiter_priority (&rw->write_waiters))
+			priority = top_waiter_priority (&rw->write_waiters);
+		h->lock.priority = priority;
+		add_held_lock (t, &h->lock);
+	}
 }
 
-void print_waiter_list(struct semaphore *sema) {
-    struct list_elem *e;
+/* Gives up the current thread's hold on RW and the donations it
+   carried, and returns the hold for the caller to free once
+   interrupts are back on.  Interrupts must be off. */
+static struct rwlock_hold *
+rwlock_drop (struct rwlock *rw) {
+	struct rwlock_hold *h = rwlock_find_hold (thread_current (), rw);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (h != NULL);
+
+	list_remove (&h->elem);
+	list_remove (&h->thread_elem);
+	h->lock.holder = NULL;
+	if (!thread_mlfqs) {
+		remove_with_lock (&h->lock);
+		refresh_priority ();
+	}
+	return h;
+}
 
-    for (e = list_begin(&sema->waiters); e != list_end(&sema->waiters); e = list_next(e)) {
-        struct thread *t = (t = list_entry(e, struct thread, elem)) != NULL ? t : NULL;
-        if (t != NULL) {
-			printf("##################################### Thread name: %s, Priority: %d, Thread: %d\n", t->name, t->priority, t->tid);
-		} else {
-			printf("Invalid thread or priority.\n");
+/* After a release, grants RW to the threads waiting for it, if
+   it is now free for them: the highest-priority writer if RW is
+   entirely free and it outranks the waiting readers (or ties
+   them, with writer preference), otherwise every waiting reader
+   unless writer preference holds them back.  Then lets the
+   remaining waiters' donations follow the new set of holders,
+   and yields if a woken thread should preempt us.  Interrupts
+   must be off. */
+static void
+rwlock_hand_off (struct rwlock *rw) {
+	struct semaphore *rq = &rw->read_waiters;
+	struct semaphore *wq = &rw->write_waiters;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rw->writer != NULL)
+		return;
+	if (rw->readers == 0 && !pheap_empty (&wq->waiters)
+			&& (rw->prefer_writers
+				|| top_waiter_priority (wq) > top_waiter_priority (rq))) {
+		rwlock_grant (rw, pheap_entry (pheap_max (&wq->waiters),
+					struct thread, wait_elem), true);
+		rwlock_wake (wq);
+	} else if (!rw->prefer_writers || pheap_empty (&wq->waiters)) {
+		while (!pheap_empty (&rq->waiters)) {
+			rwlock_grant (rw, pheap_entry (pheap_max (&rq->waiters),
+						struct thread, wait_elem), false);
+			rwlock_wake (rq);
 		}
-    }
-	printf("----------------\n");
-}
\ No newline at end of file
+	}
+
+	if (!thread_mlfqs) {
+		int priority = top_waiter_priority (rq);
+		struct list_elem *e;
+
+		if (priority < top_waiter_priority (wq))
+			priority = top_waiter_priority (wq);
+		for (e = list_begin (&rw->holds); e != list_end (&rw->holds);
+				e = list_next (e))
+			update_lock_priority (&list_entry (e, struct rwlock_hold,
+						elem)->lock, priority);
+	}
+	check_priority ();
+}
+
+/* Blocks the current thread in SEMA's waiter heap until
+   rwlock_wake() wakes it, by which time whoever woke it has
+   granted it the rwlock.  SEMA serves only as a waiter queue that
+   priority changes know how to reorder; its value stays 0.
+   Interrupts must be off. */
+static void
+rwlock_wait (struct semaphore *sema) {
+	struct thread *t = thread_current ();
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	t->wait_seq = next_wait_seq++;
+	t->blocked_sema = sema;
+	pheap_insert (&sema->waiters, &t->wait_elem);
+	thread_block ();
+}
+
+/* Wakes the highest-priority thread blocked on SEMA by
+   rwlock_wait(), without yielding. */
+static void
+rwlock_wake (struct semaphore *sema) {
+	struct thread *t = pheap_entry (pheap_pop_max (&sema->waiters),
+			struct thread, wait_elem);
+
+	t->blocked_sema = NULL;
+	thread_unblock (t);
+}
+
+/* Returns the priority of the highest-priority thread blocked on
+   SEMA, or PRI_MIN - 1 if there is none. */
+static int
+top_waiter_priority (const struct semaphore *sema) {
+	if (pheap_empty (&sema->waiters))
+		return PRI_MIN - 1;
+	return pheap_entry (pheap_max (&sema->waiters), struct thread,
+			wait_elem)->priority;
+}
+
+/* Restores the order of the waiter heaps T is in after T's
+   priority changed.  Interrupts must be off. */
+void
+sema_waiter_reprioritize (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->blocked_sema != NULL)
+		pheap_update (&t->blocked_sema->waiters, &t->wait_elem);
+	if (t->blocked_cond != NULL)
+		pheap_update (&t->blocked_cond->waiters, t->blocked_cond_elem);
+}
+
+/* Orders semaphore waiters by priority, then by arrival. */
+static bool
+sema_waiter_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct thread *a = pheap_entry (a_, struct thread, wait_elem);
+	const struct thread *b = pheap_entry (b_, struct thread, wait_elem);
+
+	if (a->priority != b->priority)
+		return a->priority < b->priority;
+	return a->wait_seq > b->wait_seq;
+}
+
+/* Orders condition variable waiters by the priority of the
+   waiting thread, then by arrival. */
+static bool
+cond_waiter_less (const struct pheap_elem *a_, const struct pheap_elem *b_,
+		void *aux UNUSED) {
+	const struct semaphore_elem *a =
+		pheap_entry (a_, struct semaphore_elem, elem);
+	const struct semaphore_elem *b =
+		pheap_entry (b_, struct semaphore_elem, elem);
+
+	if (a->thread->priority != b->thread->priority)
+		return a->thread->priority < b->thread->priority;
+	return a->seq > b->seq;
+}
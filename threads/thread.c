@@ -8,10 +8,15 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "intrinsic.h"
 #include "threads/fixed_point.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -25,42 +30,89 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
-static struct list all_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO per priority level, and bit N of
+   ready_bitmap is set iff ready_queues[N] is nonempty, so the
+   highest runnable priority is found with a single bit scan.
+   Under the completely fair scheduler the run queue is instead
+   cfs_tree, ordered by virtual runtime.  Real-time threads with
+   budget left wait in rt_tree, earliest deadline first, and run
+   ahead of either. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;           /* Nonempty ready_queues. */
+static struct rbtree rt_tree;           /* Real-time run queue, by deadline. */
+static struct rbtree cfs_tree;          /* Run queue by vruntime, under CFS. */
+static long cfs_total_weight;           /* Total weight of cfs_tree. */
+static int64_t min_vruntime;            /* Monotonic floor of vruntimes. */
+static size_t ready_cnt;                /* # of threads in the run queue. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
 
+/* Directed yield target, or null. */
+static struct thread *yield_to;
+
+/* Pages of exited threads, kept for reuse by thread_create()
+   instead of being returned to the kernel pool, at most
+   PAGE_CACHE_MAX of them. */
+static struct list page_cache;
+static size_t page_cache_cnt;
+#define PAGE_CACHE_MAX 8
+
+/* Statistics. */
+static long long idle_ticks;    /* # of timer ticks spent idle. */
+static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
+static long long user_ticks;    /* # of timer ticks in user programs. */
+
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Cache of struct thread_usage. */
+static struct kmem_cache usage_cache;
+
 /* Thread destruction requests */
 static struct list destruction_req;
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
-
 /* Add */
 // priority
-bool high_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
-void donate_priority();
-bool donate_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux);
-void remove_with_lock(struct lock *lock);
+static pheap_less_func held_lock_less;
+static void donate_from(struct thread *, int priority, int depth);
+static struct thread *donate_through(struct lock *, int priority, int depth);
 // advanced
 void mlfqs_priority(struct thread *t);
-void mlfqs_recent_cpu(struct thread *t);
 void mlfqs_load_avg();
 void mlfqs_recalculate_priority();
 void mlfqs_recalculate_recent_cpu();
+static void mlfqs_catch_up(struct thread *t);
+static work_func mlfqs_decay_ready;
 int load_avg;
 
+/* The once-per-second recent_cpu decay is applied lazily.  Each
+   decay starts a new epoch; a thread records the last epoch it
+   has caught up to and applies the missed decays the next time
+   it is inspected.  The load average in effect for each of the
+   last DECAY_HISTORY decays is kept so that a sleeper catches up
+   exactly as if it had been decayed on time. */
+#define DECAY_HISTORY 64
+static int64_t decay_epoch;                 /* # of decays so far. */
+static int decay_load_avg[DECAY_HISTORY];   /* Load average of decay E
+                                               at E % DECAY_HISTORY. */
+static struct work decay_work;              /* Catches up ready threads. */
+
+/* Priority donation.  A donation is propagated through at most
+   donation_depth_limit nested locks.  Controlled by kernel
+   command-line option "-donate-depth=N". */
+int donation_depth_limit = 8;
+static long long donation_truncated;    /* # of chains cut short. */
+
+/* Thread pages. */
+static long long thread_pages;          /* # of pages given to new threads. */
+static long long thread_pages_recycled; /* # of those taken from a cache. */
+
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
@@ -70,6 +122,60 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use the completely fair scheduler instead.
+   Controlled by kernel command-line option "-cfs".
+
+   Each thread accumulates virtual runtime (vruntime): CPU time
+   scaled down by a weight that grows by about 25% per step of
+   nice decrease, so that threads of equal vruntime have received
+   CPU in proportion to their weights.  The thread with the least
+   vruntime runs next, and each runs for its weighted share of a
+   target latency, the period in which every ready thread should
+   get a turn.  Priorities only order waiters on semaphores. */
+bool thread_cfs;
+
+#define CFS_LATENCY 6           /* Target latency, in timer ticks. */
+#define CFS_MIN_GRANULARITY 1   /* Shortest slice, in timer ticks. */
+#define CFS_TICK 1024           /* One tick of nice-0 vruntime. */
+#define CFS_WAKEUP_GRANULARITY CFS_TICK  /* Lead to preempt on wakeup. */
+#define CFS_SLEEPER_CREDIT (CFS_LATENCY * CFS_TICK / 2)
+
+/* Real-time class.  A thread that calls thread_set_deadline()
+   with RUNTIME and PERIOD is reserved RUNTIME ticks of CPU time in
+   every PERIOD ticks.  While it has budget left it runs ahead of
+   all other threads, earliest deadline (end of period) first.
+   Once its budget runs out it is throttled, dropping to its
+   normal priority until its next period begins, so it can never
+   take more than its reservation from other real-time threads.
+   A thread that wakes up after sleeping through part of its
+   period is given a fresh period if its leftover budget would
+   otherwise exceed its reserved bandwidth (the constant-bandwidth
+   server rule).
+
+   Admission control keeps the total reserved bandwidth, in units
+   of 1 / (1 << RT_BW_SHIFT), within RT_BW_MAX, so that EDF can
+   meet every deadline and some time is left for other threads. */
+#define RT_BW_SHIFT 20
+#define RT_BW_MAX ((1 << RT_BW_SHIFT) * 95 / 100)
+
+static struct list rt_threads;      /* All real-time threads. */
+static int64_t rt_bandwidth;        /* Total reserved bandwidth. */
+static long long rt_periods;        /* # of periods completed. */
+static long long rt_misses;         /* # of those with a missed deadline. */
+
+/* CFS weights for nice -20 to 20.  Nice 0 is 1024. */
+static const int cfs_nice_weight[] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+	/*  20 */ 12,
+};
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -77,7 +183,28 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
 static void schedule (void);
+static void account_switch (struct thread *curr, struct thread *next);
+static struct thread_usage *thread_usage_alloc (void);
+static void thread_usage_free (struct thread *);
 static tid_t allocate_tid (void);
+static void ready_init (void);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static struct thread *ready_pop (void);
+static size_t ready_threads (void);
+static struct thread *thread_page_alloc (void);
+static void thread_page_free (struct thread *);
+static int cfs_weight (const struct thread *);
+static void cfs_update_min_vruntime (void);
+static unsigned cfs_slice (const struct thread *);
+static bool cfs_should_preempt (void);
+static rb_less_func cfs_less;
+static bool rt_active (const struct thread *);
+static bool rt_tick (struct thread *curr);
+static bool rt_preempts (const struct thread *);
+static void rt_leave (struct thread *);
+static rb_less_func rt_less;
 
 /* Returns true if T appears to point to a valid thread. */
 #define is_thread(t) ((t) != NULL && (t)->magic == THREAD_MAGIC)
@@ -123,16 +250,18 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	lock_init (&tid_lock);
-	list_init (&ready_list);
+	lock_set_name (&tid_lock, "tid");
+	ready_init ();
+	kmem_cache_init (&usage_cache, "thread_usage",
+			sizeof (struct thread_usage), NULL);
 	list_init (&destruction_req);
-	list_init (&all_list);
+	list_init (&rt_threads);
+	work_init (&decay_work, mlfqs_decay_ready, NULL, WORK_HIGH);
 
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread ();
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 
-	if (thread_mlfqs)
-		list_push_back(&all_list, &(initial_thread->all_elem));
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
 }
@@ -143,6 +272,9 @@ void
 thread_start (void) {
 	struct semaphore idle_started;
 	sema_init (&idle_started, 0);
+	initial_thread->usage = thread_usage_alloc ();
+	if (initial_thread->usage != NULL)
+		initial_thread->usage->state_since = timer_ticks ();
 	thread_create ("idle", PRI_MIN, idle, &idle_started);
 	load_avg = 0; // 전역변수 초기화
 
@@ -150,35 +282,69 @@ thread_start (void) {
 	sema_down (&idle_started);
 }
 
-/* Called by the timer interrupt handler at each timer tick.
+/* Called by the timer interrupt handler at each timer tick, with
+   USER true if the tick interrupted user code.
    Thus, this function runs in an external interrupt context. */
 void
-thread_tick (void) {
+thread_tick (bool user) {
 	struct thread *t = thread_current ();
 
 	/* Update statistics. */
 	if (t == idle_thread)
 		idle_ticks++;
-#ifdef USERPROG
-	else if (t->pml4 != NULL)
+	else if (user) {
 		user_ticks++;
-#endif
-	else
+		if (t->usage != NULL)
+			t->usage->self.user_ticks++;
+	} else {
 		kernel_ticks++;
+		if (t->usage != NULL)
+			t->usage->self.kernel_ticks++;
+	}
 
-	/* Enforce preemption. */
-	if (++thread_ticks >= TIME_SLICE){
-		if (!list_empty(&ready_list)) {
+	/* Enforce preemption.  A real-time thread runs until it
+	   blocks, exhausts its budget or is preempted by an earlier
+	   deadline. */
+	if (!list_empty (&rt_threads) && rt_tick (t))
+		intr_yield_on_return ();
+	else if (rt_active (t))
+		return;
+	else if (thread_cfs) {
+		++thread_ticks;
+		if (t != idle_thread) {
+			t->vruntime += CFS_TICK * 1024 / cfs_weight (t);
+			cfs_update_min_vruntime ();
+		}
+		if (ready_cnt > 0 && thread_ticks >= cfs_slice (t))
+			intr_yield_on_return ();
+	} else if (++thread_ticks >= TIME_SLICE){
+		if (ready_bitmap != 0) {
 			intr_yield_on_return ();
 		}
 	}
 }
 
+/* Credits CNT timer ticks, which passed without a timer interrupt
+   while the CPU was halted, to the idle thread. */
+void
+thread_account_idle (int64_t cnt) {
+	idle_ticks += cnt;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
 	printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 			idle_ticks, kernel_ticks, user_ticks);
+	if (donation_truncated > 0)
+		printf ("Thread: %lld donation chains truncated at depth %d\n",
+				donation_truncated, donation_depth_limit);
+	if (rt_periods > 0)
+		printf ("Thread: %lld of %lld real-time deadlines missed\n",
+				rt_misses, rt_periods);
+	if (thread_pages_recycled > 0)
+		printf ("Thread: %lld of %lld thread pages recycled\n",
+				thread_pages_recycled, thread_pages);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -205,13 +371,16 @@ thread_create (const char *name, int priority,
 	ASSERT (function != NULL);
 
 	/* Allocate thread. */
-	t = palloc_get_page (PAL_ZERO);
+	t = thread_page_alloc ();
 	if (t == NULL){
 		return TID_ERROR;
 	}
 	/* Initialize thread. */
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
+	t->usage = thread_usage_alloc ();
+	TRACE_NAME_THREAD (tid, t->name);
+	t->timer_slack = thread_current ()->timer_slack;
 
 	/* Call the kernel_thread if it scheduled.
 	 * Note) rdi is 1st argument, and rsi is 2nd argument. */
@@ -231,18 +400,10 @@ thread_create (const char *name, int priority,
 		t->recent_cpu = thread_current()->recent_cpu;
 	}
 
-	/*------- PROJECT 2 : USER PROGRAMS -------*/
-	t->fd_table = palloc_get_multiple(PAL_ZERO, FD_PAGES); //FD_PAGE 변수로 선언해줌
-	if (t->fd_table == NULL)
-		return TID_ERROR;
-	
-	t->fd_table[STD_IN] = 0;	//0,1,2로 init값 변경해 봤으나 1,2,3도 상관없다는 결론 (oom_update)
-	t->fd_table[STD_OUT] = 1;
-	t->fd_table[STD_ERR] = 2;
-	// t->next_fd = 3;
-	/*-----------------------------------------*/
-
-	/* Add to run queue. */
+	/* Add to run queue.  The thread counts as blocked since its
+	   creation until now, that is, not at all. */
+	if (t->usage != NULL)
+		t->usage->state_since = timer_ticks ();
 	thread_unblock (t);
 	check_priority();
 
@@ -274,14 +435,44 @@ thread_block (void) {
 void
 thread_unblock (struct thread *t) {
 	enum intr_level old_level;
+	int64_t now;
 
 	ASSERT (is_thread (t));
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	// list_push_back (&ready_list, &t->elem);
-	list_insert_ordered (&ready_list, &t->elem, high_priority, NULL);
+	now = timer_ticks ();
+	if (t->usage != NULL) {
+		t->usage->self.blocked_ticks += now - t->usage->state_since;
+		t->usage->self.wakeups++;
+		t->usage->state_since = now;
+		t->usage->woken_tsc = rdtsc () | 1;
+	}
+	if (thread_mlfqs) {
+		mlfqs_catch_up (t);
+		mlfqs_priority (t);
+	}
+	if (t->rt_period != 0) {
+		/* Keep the leftover budget only if it fits in what is left
+		   of the period at the reserved bandwidth. */
+		if (!t->rt_throttled && (t->rt_deadline <= now
+					|| t->rt_budget * t->rt_period
+					> (t->rt_deadline - now) * t->rt_runtime)) {
+			t->rt_deadline = now + t->rt_period;
+			t->rt_budget = t->rt_runtime;
+		}
+	}
+	if (thread_cfs && !rt_active (t)) {
+		/* Don't let a sleeper bank more than half a latency's
+		   worth of credit. */
+		cfs_update_min_vruntime ();
+		if (t->vruntime < min_vruntime - CFS_SLEEPER_CREDIT)
+			t->vruntime = min_vruntime - CFS_SLEEPER_CREDIT;
+	}
+	ready_push (t);
 	t->status = THREAD_READY;
+	TRACE (TRACE_WAKEUP, t->tid, intr_context () ? 0 : running_thread ()->tid,
+			t->priority);
 
 	intr_set_level (old_level);
 }
@@ -292,6 +483,12 @@ thread_name (void) {
 	return thread_current ()->name;
 }
 
+/* Returns true if some other thread is ready to run. */
+bool
+thread_others_ready (void) {
+	return ready_cnt > 0;
+}
+
 /* Returns the running thread.
    This is running_thread() plus a couple of sanity checks.
    See the big comment at the top of thread.h for details. */
@@ -325,12 +522,13 @@ thread_exit (void) {
 #ifdef USERPROG
 	process_exit ();
 #endif
-	if (thread_mlfqs)
-        list_remove(&thread_current()->all_elem);
+	thread_usage_free (thread_current ());
 
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	if (thread_current ()->rt_period != 0)
+		rt_leave (thread_current ());
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -346,8 +544,32 @@ thread_yield (void) {
 
 	old_level = intr_disable ();
 	if (curr != idle_thread)
-		// list_push_back (&ready_list, &curr->elem);
-		list_insert_ordered (&ready_list, &curr->elem, high_priority, NULL);
+		ready_push (curr);
+	do_schedule (THREAD_READY);
+	intr_set_level (old_level);
+}
+
+/* Yields the CPU directly to T, which runs next for the rest of
+   the current time slice if it is ready and neither the current
+   thread nor any ready thread outranks it.  Otherwise behaves
+   like thread_yield().  The current thread stays ready, so it
+   runs again as soon as T blocks or is preempted. */
+void
+thread_yield_to (struct thread *t) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (!intr_context ());
+	ASSERT (is_thread (t));
+
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && !rt_preempts (t)
+			&& (thread_cfs || (t->priority >= curr->priority
+				&& (ready_bitmap == 0
+					|| t->priority >= ready_max_priority ()))))
+		yield_to = t;
+	if (curr != idle_thread)
+		ready_push (curr);
 	do_schedule (THREAD_READY);
 	intr_set_level (old_level);
 }
@@ -373,6 +595,47 @@ thread_get_priority (void) {
 	return thread_current ()->priority;
 }
 
+/* Makes the current thread a real-time thread that is reserved
+   RUNTIME timer ticks of CPU time in every PERIOD ticks, starting
+   now; see the comment on RT_BW_SHIFT.  RUNTIME and PERIOD both 0
+   return it to its normal scheduling class.  Returns false,
+   changing nothing, if the arguments are invalid or granting the
+   reservation would overcommit the CPU. */
+bool
+thread_set_deadline (int64_t runtime, int64_t period) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+	int64_t old_bw, new_bw;
+
+	ASSERT (!intr_context ());
+
+	if (runtime < 0 || runtime > period || (runtime == 0) != (period == 0))
+		return false;
+
+	old_level = intr_disable ();
+	old_bw = t->rt_period != 0
+		? (t->rt_runtime << RT_BW_SHIFT) / t->rt_period : 0;
+	new_bw = period != 0 ? (runtime << RT_BW_SHIFT) / period : 0;
+	if (rt_bandwidth - old_bw + new_bw > RT_BW_MAX) {
+		intr_set_level (old_level);
+		return false;
+	}
+
+	if (t->rt_period != 0)
+		rt_leave (t);
+	if (period != 0) {
+		rt_bandwidth += new_bw;
+		list_push_back (&rt_threads, &t->rt_allelem);
+		t->rt_runtime = t->rt_budget = runtime;
+		t->rt_period = period;
+		t->rt_deadline = timer_ticks () + period;
+		t->rt_throttled = false;
+	}
+	check_priority ();
+	intr_set_level (old_level);
+	return true;
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int nice UNUSED) {
@@ -381,7 +644,8 @@ thread_set_nice (int nice UNUSED) {
 	enum intr_level old_level;
 	old_level = intr_disable ();
 	t->nice = nice;
-	mlfqs_priority(t);
+	if (thread_mlfqs)
+		mlfqs_priority(t);
 	check_priority();
 	intr_set_level (old_level);
 }
@@ -453,7 +717,15 @@ idle (void *idle_started_ UNUSED) {
 		   time.
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-		   7.11.1 "HLT Instruction". */
+		   7.11.1 "HLT Instruction".
+
+		   In tickless mode, the periodic timer interrupt is
+		   replaced by a single one at the nearest deadline first.
+
+		   Idle-time work, if any is wanted, runs instead. */
+		if (palloc_idle ())
+			continue;
+		timer_idle_enter ();
 		asm volatile ("sti; hlt" : : : "memory");
 	}
 }
@@ -481,21 +753,22 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->status = THREAD_BLOCKED;
 	strlcpy (t->name, name, sizeof t->name);
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
+	t->magic = THREAD_MAGIC;
 
 	if (thread_mlfqs) {
+		t->decay_epoch = decay_epoch;
 		mlfqs_priority(t);
-		list_push_back(&all_list, &t->all_elem);
 	} else {
 		t->priority = priority;
 	}
 
-	t->magic = THREAD_MAGIC;
-
 	t->ori_priority = priority;
-	list_init(&t->donations);
+	pheap_init(&t->held_locks, held_lock_less, NULL);
+	list_init(&t->rw_holds);
 
 	t->nice = 0;
 	t->recent_cpu = 0;
+	t->vruntime = min_vruntime;
 	t->next_fd = 3;	//(oom_update)
 // #ifdef USERPROG
 	sema_init(&t->fork_sema, 0);
@@ -507,16 +780,187 @@ init_thread (struct thread *t, const char *name, int priority) {
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from the run queue, unless the run
+   queue is empty.  (If the running thread can continue running,
+   then it will be in the run queue.)  A pending thread_yield_to()
+   target takes precedence over priority.  If the run queue is empty,
+   return idle_thread. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
+	struct thread *next;
+
+	if (yield_to != NULL) {
+		next = yield_to;
+		yield_to = NULL;
+		if (next->status == THREAD_READY) {
+			ready_remove (next);
+			return next;
+		}
+	}
+
+	if (ready_cnt == 0)
 		return idle_thread;
-	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+	return ready_pop ();
+}
+
+/* Initializes the run queues and the page cache. */
+static void
+ready_init (void) {
+	int i;
+
+	for (i = PRI_MIN; i <= PRI_MAX; i++)
+		list_init (&ready_queues[i]);
+	list_init (&page_cache);
+	rb_init (&rt_tree, rt_less, NULL);
+	rb_init (&cfs_tree, cfs_less, NULL);
+}
+
+/* Removes and returns the thread that should run next from the
+   run queue, which must be nonempty. */
+static struct thread *
+ready_pop (void) {
+	struct thread *t;
+
+	if (!rb_empty (&rt_tree)) {
+		t = rb_entry (rb_min (&rt_tree), struct thread, rt_elem);
+		rb_remove (&rt_tree, &t->rt_elem);
+	} else if (thread_cfs) {
+		t = rb_entry (rb_min (&cfs_tree), struct thread, cfs_elem);
+		rb_remove (&cfs_tree, &t->cfs_elem);
+		cfs_total_weight -= cfs_weight (t);
+	} else {
+		struct list *q = &ready_queues[ready_max_priority ()];
+		t = list_entry (list_pop_front (q), struct thread, elem);
+		if (list_empty (q))
+			ready_bitmap &= ~(1ULL << t->priority);
+	}
+	ready_cnt--;
+	return t;
+}
+
+/* Returns a page for a new thread's struct thread and stack,
+   preferably one recycled from an exited thread.  A recycled page
+   is not zeroed: init_thread() clears the struct thread, and the
+   stack needs no clearing.  Returns a null pointer if no page is
+   available. */
+static struct thread *
+thread_page_alloc (void) {
+	struct thread *t = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!list_empty (&page_cache)) {
+		t = list_entry (list_pop_front (&page_cache), struct thread, elem);
+		page_cache_cnt--;
+		thread_pages_recycled++;
+	}
+	intr_set_level (old_level);
+
+	if (t == NULL)
+		t = palloc_get_page (PAL_ZERO);
+	if (t != NULL)
+		thread_pages++;
+	return t;
+}
+
+/* Releases the page of exited thread T, keeping it in
+   page_cache unless the cache is full.  Interrupts must be off. */
+static void
+thread_page_free (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (page_cache_cnt < PAGE_CACHE_MAX) {
+		list_push_front (&page_cache, &t->elem);
+		page_cache_cnt++;
+	} else
+		palloc_free_page (t);
+}
+
+/* Returns the number of threads that are ready to run or
+   running, not counting the idle thread. */
+static size_t
+ready_threads (void) {
+	return ready_cnt + (running_thread () != idle_thread);
+}
+
+/* Returns the index of the most significant set bit in the
+   nonzero word X. */
+static inline int
+bit_scan_reverse (uint64_t x) {
+	uint64_t idx;
+	__asm __volatile ("bsrq %1, %0" : "=r" (idx) : "rm" (x));
+	return (int) idx;
+}
+
+/* Returns the highest priority level with a nonempty run queue.
+   The run queue must not be empty. */
+static int
+ready_max_priority (void) {
+	ASSERT (ready_bitmap != 0);
+	return bit_scan_reverse (ready_bitmap);
+}
+
+/* Appends T to the tail of the run queue for its
+   priority, or under CFS inserts it by vruntime.  A real-time
+   thread with budget left goes into the EDF queue instead. */
+static void
+ready_push (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+	if (rt_active (t))
+		rb_insert (&rt_tree, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_insert (&cfs_tree, &t->cfs_elem);
+		cfs_total_weight += cfs_weight (t);
+	} else {
+		list_push_back (&ready_queues[t->priority], &t->elem);
+		ready_bitmap |= 1ULL << t->priority;
+	}
+	ready_cnt++;
+}
+
+/* Removes T from the run queue. */
+static void
+ready_remove (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rt_active (t))
+		rb_remove (&rt_tree, &t->rt_elem);
+	else if (thread_cfs) {
+		rb_remove (&cfs_tree, &t->cfs_elem);
+		cfs_total_weight -= cfs_weight (t);
+	} else {
+		list_remove (&t->elem);
+		if (list_empty (&ready_queues[t->priority]))
+			ready_bitmap &= ~(1ULL << t->priority);
+	}
+	ready_cnt--;
+}
+
+/* Changes the effective priority of T to PRIORITY.  If T is in
+   a priority run queue, it is moved to the tail of the queue for
+   its new priority level; if it is waiting on a semaphore or
+   condition variable, its place among the waiters is updated. */
+void
+thread_update_priority (struct thread *t, int priority) {
+	enum intr_level old_level;
+
+	ASSERT (is_thread (t));
+	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+	if (t->priority == priority)
+		return;
+
+	old_level = intr_disable ();
+	if (t->status == THREAD_READY && !thread_cfs) {
+		ready_remove (t);
+		t->priority = priority;
+		ready_push (t);
+	} else
+		t->priority = priority;
+	if (t->blocked_sema != NULL || t->blocked_cond != NULL)
+		sema_waiter_reprioritize (t);
+	intr_set_level (old_level);
 }
 
 /* Use iretq to launch the thread */
@@ -547,73 +991,21 @@ do_iret (struct intr_frame *tf) {
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
-/* Switching the thread by activating the new thread's page
-   tables, and, if the previous thread is dying, destroying it.
+/* Switches from the running thread to TH.
 
-   At this function's invocation, we just switched from thread
-   PREV, the new thread is already running, and interrupts are
-   still disabled.
-
-   It's not safe to call printf() until the thread switch is
-   complete.  In practice that means that printf()s should be
-   added at the end of the function. */
+   At this function's invocation, interrupts are disabled and the
+   new thread's address space, if any, is already active.  We
+   return when some later schedule() switches back to us. */
 static void
 thread_launch (struct thread *th) {
-	uint64_t tf_cur = (uint64_t) &running_thread ()->tf;
-	uint64_t tf = (uint64_t) &th->tf;
+	struct thread *curr = running_thread ();
+
 	ASSERT (intr_get_level () == INTR_OFF);
 
-	/* The main switching logic.
-	 * We first restore the whole execution context into the intr_frame
-	 * and then switching to the next thread by calling do_iret.
-	 * Note that, we SHOULD NOT use any stack from here
-	 * until switching is done. */
-	__asm __volatile (
-			/* Store registers that will be used. */
-			"push %%rax\n"
-			"push %%rbx\n"
-			"push %%rcx\n"
-			/* Fetch input once */
-			"movq %0, %%rax\n"
-			"movq %1, %%rcx\n"
-			"movq %%r15, 0(%%rax)\n"
-			"movq %%r14, 8(%%rax)\n"
-			"movq %%r13, 16(%%rax)\n"
-			"movq %%r12, 24(%%rax)\n"
-			"movq %%r11, 32(%%rax)\n"
-			"movq %%r10, 40(%%rax)\n"
-			"movq %%r9, 48(%%rax)\n"
-			"movq %%r8, 56(%%rax)\n"
-			"movq %%rsi, 64(%%rax)\n"
-			"movq %%rdi, 72(%%rax)\n"
-			"movq %%rbp, 80(%%rax)\n"
-			"movq %%rdx, 88(%%rax)\n"
-			"pop %%rbx\n"              // Saved rcx
-			"movq %%rbx, 96(%%rax)\n"
-			"pop %%rbx\n"              // Saved rbx
-			"movq %%rbx, 104(%%rax)\n"
-			"pop %%rbx\n"              // Saved rax
-			"movq %%rbx, 112(%%rax)\n"
-			"addq $120, %%rax\n"
-			"movw %%es, (%%rax)\n"
-			"movw %%ds, 8(%%rax)\n"
-			"addq $32, %%rax\n"
-			"call __next\n"         // read the current rip.
-			"__next:\n"
-			"pop %%rbx\n"
-			"addq $(out_iret -  __next), %%rbx\n"
-			"movq %%rbx, 0(%%rax)\n" // rip
-			"movw %%cs, 8(%%rax)\n"  // cs
-			"pushfq\n"
-			"popq %%rbx\n"
-			"mov %%rbx, 16(%%rax)\n" // eflags
-			"mov %%rsp, 24(%%rax)\n" // rsp
-			"movw %%ss, 32(%%rax)\n"
-			"mov %%rcx, %%rdi\n"
-			"call do_iret\n"
-			"out_iret:\n"
-			: : "g"(tf_cur), "g" (tf) : "memory"
-			);
+	if (th->switch_rsp != 0)
+		switch_threads (&curr->switch_rsp, th->switch_rsp);
+	else
+		switch_to_new (&curr->switch_rsp, &th->tf);
 }
 
 /* Schedules a new process. At entry, interrupts must be off.
@@ -627,7 +1019,7 @@ do_schedule(int status) {
 	while (!list_empty (&destruction_req)) {
 		struct thread *victim =
 			list_entry (list_pop_front (&destruction_req), struct thread, elem);
-		palloc_free_page(victim);
+		thread_page_free (victim);
 	}
 	thread_current ()->status = status;
 	schedule ();
@@ -636,16 +1028,28 @@ do_schedule(int status) {
 static void
 schedule (void) {
 	struct thread *curr = running_thread ();
-	struct thread *next = next_thread_to_run ();
+	struct thread *next, *handoff;
 
 	ASSERT (intr_get_level () == INTR_OFF);
 	ASSERT (curr->status != THREAD_RUNNING);
+
+	/* Leaving the idle thread: restore the periodic tick, and
+	   catch up on the ticks skipped meanwhile before choosing the
+	   next thread. */
+	if (curr == idle_thread)
+		timer_idle_exit ();
+
+	handoff = yield_to;
+	next = next_thread_to_run ();
 	ASSERT (is_thread (next));
+	account_switch (curr, next);
 	/* Mark us as running. */
 	next->status = THREAD_RUNNING;
 
-	/* Start new time slice. */
-	thread_ticks = 0;
+	/* Start new time slice, unless we are handing over the rest
+	   of ours. */
+	if (next != handoff)
+		thread_ticks = 0;
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -665,12 +1069,80 @@ schedule (void) {
 			list_push_back (&destruction_req, &curr->elem);
 		}
 
+		TRACE (TRACE_SWITCH, curr->tid, next->tid, curr->status);
+
 		/* Before switching the thread, we first save the information
 		 * of current running. */
 		thread_launch (next);
 	}
 }
 
+/* Updates the usage of CURR, which is leaving the CPU, and NEXT,
+   which is about to run, which may be the same thread. */
+static void
+account_switch (struct thread *curr, struct thread *next) {
+	struct thread_usage *u = next->usage;
+	int64_t now = timer_ticks ();
+
+	if (curr->usage != NULL)
+		curr->usage->state_since = now;
+	if (u == NULL)
+		return;
+	u->self.ready_ticks += now - u->state_since;
+	if (curr != next)
+		u->self.switches++;
+	if (u->woken_tsc != 0) {
+		uint64_t cycles = rdtsc () - u->woken_tsc;
+		int bucket = cycles > 1 ? 63 - __builtin_clzll (cycles) : 0;
+
+		if (bucket >= RUSAGE_LATENCY_CNT)
+			bucket = RUSAGE_LATENCY_CNT - 1;
+		u->self.latency[bucket]++;
+		u->woken_tsc = 0;
+	}
+}
+
+/* Returns a new, zeroed struct thread_usage, or a null pointer
+   if memory is not available, in which case the thread goes
+   unaccounted. */
+static struct thread_usage *
+thread_usage_alloc (void) {
+	struct thread_usage *u = kmem_cache_alloc (&usage_cache);
+
+	if (u != NULL)
+		memset (u, 0, sizeof *u);
+	return u;
+}
+
+/* Frees T's usage.  Its parent must be done reading it. */
+static void
+thread_usage_free (struct thread *t) {
+	struct thread_usage *u;
+	enum intr_level old_level;
+
+	/* The scheduler updates it with interrupts off. */
+	old_level = intr_disable ();
+	u = t->usage;
+	t->usage = NULL;
+	intr_set_level (old_level);
+	kmem_cache_free (&usage_cache, u);
+}
+
+/* Adds the usage in B to A. */
+void
+thread_rusage_add (struct rusage *a, const struct rusage *b) {
+	int i;
+
+	a->ready_ticks += b->ready_ticks;
+	a->kernel_ticks += b->kernel_ticks;
+	a->user_ticks += b->user_ticks;
+	a->blocked_ticks += b->blocked_ticks;
+	a->wakeups += b->wakeups;
+	a->switches += b->switches;
+	for (i = 0; i < RUSAGE_LATENCY_CNT; i++)
+		a->latency[i] += b->latency[i];
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) {
@@ -685,12 +1157,20 @@ allocate_tid (void) {
 }
 
 void check_priority() {
-	if (list_empty(&ready_list))
+	struct thread *curr = thread_current();
+	bool preempt;
+
+	if (ready_cnt == 0)
 		return;
 
-	struct thread *t = list_entry(list_front(&ready_list), struct thread, elem);
+	if (!rb_empty (&rt_tree) || rt_active (curr))
+		preempt = rt_preempts (curr);
+	else if (thread_cfs)
+		preempt = cfs_should_preempt ();
+	else
+		preempt = curr->priority < ready_max_priority ();
 
-	if (thread_current()->priority < t->priority) {
+	if (preempt) {
 		if (intr_context())
 			intr_yield_on_return();
 		else
@@ -698,128 +1178,320 @@ void check_priority() {
 	}
 }
 
-bool high_priority (const struct list_elem *a, const struct list_elem *b, void *aux) {
-	const struct thread *priority_a = list_entry(a, struct thread, elem);
-	const struct thread *priority_b = list_entry(b, struct thread, elem);
-	return priority_a->priority > priority_b->priority;
-}
-
 void print_ready_list(void) {
 	struct list_elem *e;
 	struct thread *t = thread_current();
 
 	printf("\n################################# Running Thread name: %s, Priority: %d, Thread: %d\n", t->name, t->priority, t->tid);
-	for (e = list_begin(&ready_list); e != list_end(&ready_list); e = list_next(e)) {
-		struct thread *t = (t = list_entry(e, struct thread, elem)) != NULL ? t : NULL;
-		if (t != NULL) {
+	if (thread_cfs) {
+		struct rbtree *tree = &cfs_tree;
+		struct rb_elem *r;
+		for (r = rb_empty (tree) ? NULL : rb_min (tree); r != NULL; r = rb_next (r)) {
+			struct thread *t = rb_entry (r, struct thread, cfs_elem);
+			printf("##################################### Thread name: %s, Vruntime: %lld, Thread: %d\n", t->name, t->vruntime, t->tid);
+		}
+	}
+	for (int pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+		struct list *q = &ready_queues[pri];
+		for (e = list_begin(q); e != list_end(q); e = list_next(e)) {
+			struct thread *t = list_entry(e, struct thread, elem);
 			printf("##################################### Thread name: %s, Priority: %d, Thread: %d\n", t->name, t->priority, t->tid);
-		} else {
-			printf("Invalid thread or priority.\n");
 		}
 	}
 	printf("----------------\n");
 }
 
+/* Donates the running thread's priority along the chain of
+   locks it is about to block on.  Each lock caches the highest
+   priority among its waiters, and each holder keeps its held
+   locks in a heap keyed by that value, so a holder's effective
+   priority is just the larger of its own priority and its top
+   lock's.  Propagation stops as soon as a holder's priority does
+   not change, or after donation_depth_limit locks. */
 void donate_priority() {
 	struct thread *t = thread_current();
-	struct lock *now_wait_on_lock = t->wait_on_lock;
+	enum intr_level old_level = intr_disable();
+	donate_from(t, t->priority, 0);
+	intr_set_level(old_level);
+}
 
-	list_sort(&now_wait_on_lock->holder->donations, donate_high_priority, NULL);
-	list_insert_ordered(&now_wait_on_lock->holder->donations, &t->donation_elem, donate_high_priority, NULL);
-	while (now_wait_on_lock) {
-		struct thread *now_t = now_wait_on_lock->holder;
-		struct thread *don_t = list_entry(list_front(&now_t->donations), struct thread, donation_elem);
+/* Donates PRIORITY, T's priority, to the holder of the lock T
+   waits on, or to every holder of the rwlock T waits on, and
+   onward along the chains they wait on in turn.  DEPTH is the
+   number of locks already passed.  Interrupts must be off. */
+static void
+donate_from(struct thread *t, int priority, int depth) {
+	struct rwlock *rw;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	while (t != NULL) {
+		rw = t->wait_on_lock == NULL ? rwlock_waited_on(t) : NULL;
+		if (rw != NULL) {
+			struct list_elem *e;
+
+			for (e = list_begin(&rw->holds); e != list_end(&rw->holds);
+					e = list_next(e)) {
+				struct thread *holder = donate_through(
+						&list_entry(e, struct rwlock_hold, elem)->lock,
+						priority, depth);
+				if (holder != NULL)
+					donate_from(holder, holder->priority, depth + 1);
+			}
+			return;
+		}
+		if (t->wait_on_lock == NULL)
+			return;
+		t = donate_through(t->wait_on_lock, priority, depth++);
+		if (t != NULL)
+			priority = t->priority;
+	}
+}
 
-		if (now_t->priority < don_t->priority)
-			now_t->priority = don_t->priority;
-		now_wait_on_lock = now_t->wait_on_lock;
+/* Raises the priority LOCK carries to PRIORITY, DEPTH locks into
+   a donation chain, and its holder's along with it.  Returns the
+   holder if its priority rose, so that the donation goes on to
+   whatever it waits on, or a null pointer if the chain ends
+   here.  Interrupts must be off. */
+static struct thread *
+donate_through(struct lock *lock, int priority, int depth) {
+	struct thread *holder = lock->holder;
+	int new_priority;
+
+	if (holder == NULL || lock->priority >= priority)
+		return NULL;
+	if (depth >= donation_depth_limit) {
+		donation_truncated++;
+		return NULL;
 	}
+
+	TRACE(TRACE_DONATE, running_thread()->tid, holder->tid, priority);
+	lock->priority = priority;
+	pheap_update(&holder->held_locks, &lock->holder_elem);
+
+	new_priority = effective_priority(holder);
+	if (new_priority == holder->priority)
+		return NULL;
+	thread_update_priority(holder, new_priority);
+	return holder;
 }
 
-bool donate_high_priority (const struct list_elem *a, const struct list_elem *b, void *aux) {
-	const struct thread *priority_a = list_entry(a, struct thread, donation_elem);
-	const struct thread *priority_b = list_entry(b, struct thread, donation_elem);
-	return priority_a->priority > priority_b->priority;
+/* Returns T's priority including donations: the larger of its
+   own priority and the highest priority waiting on a lock it
+   holds. */
+int effective_priority(const struct thread *t) {
+	int priority = t->ori_priority;
+	if (!pheap_empty(&t->held_locks)) {
+		struct lock *top = pheap_entry(pheap_max(&t->held_locks), struct lock, holder_elem);
+		if (priority < top->priority)
+			priority = top->priority;
+	}
+	return priority;
 }
 
+/* Recomputes the running thread's priority from its own priority
+   and the locks it still holds. */
 void refresh_priority() {
 	struct thread *t = thread_current();
-	t->priority = t->ori_priority;
-	if (!list_empty(&t->donations)) {
-		struct thread *don_front = list_entry(list_max(&t->donations, donate_high_priority, NULL), struct thread, donation_elem);
-		if (t->priority < don_front->priority) {
-			t->priority = don_front->priority;
-		}
-	}
+	thread_update_priority(t, effective_priority(t));
 }
 
+/* Records that the running thread now holds LOCK.  The threads
+   still waiting on LOCK donate to their new holder. */
+void add_with_lock(struct lock *lock) {
+	struct thread *t = thread_current();
+	enum intr_level old_level = intr_disable();
+
+	if (pheap_empty(&lock->semaphore.waiters))
+		lock->priority = PRI_MIN - 1;
+	else
+		lock->priority = pheap_entry(pheap_max(&lock->semaphore.waiters), struct thread, wait_elem)->priority;
+	pheap_insert(&t->held_locks, &lock->holder_elem);
+	intr_set_level(old_level);
+}
+
+/* Records that the running thread no longer holds LOCK, which
+   withdraws the donations made through it. */
 void remove_with_lock(struct lock *lock) {
 	struct thread *t = thread_current();
-	for (struct list_elem *don_elem = list_begin(&t->donations); don_elem != list_end(&t->donations);){
-		struct list_elem *next_elem = list_next(don_elem);
-		if (lock == list_entry(don_elem, struct thread, donation_elem)->wait_on_lock){
-			list_remove(don_elem);
-		}
-		don_elem = next_elem;
-	}
+	enum intr_level old_level = intr_disable();
+	pheap_remove(&t->held_locks, &lock->holder_elem);
+	intr_set_level(old_level);
+}
+
+/* Records that T now holds LOCK, whose priority the caller has
+   set to the highest priority waiting on it, and raises T's
+   priority to match if needed.  Interrupts must be off. */
+void add_held_lock(struct thread *t, struct lock *lock) {
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	lock->holder = t;
+	pheap_insert(&t->held_locks, &lock->holder_elem);
+	if (lock->priority > t->priority)
+		thread_update_priority(t, lock->priority);
+}
+
+/* Sets the priority carried by LOCK, which must be held, to
+   PRIORITY, and recomputes its holder's priority.  Unlike
+   donate_priority() this may lower it, and does not follow
+   the holder's own wait.  Interrupts must be off. */
+void update_lock_priority(struct lock *lock, int priority) {
+	struct thread *holder = lock->holder;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	ASSERT(holder != NULL);
+
+	lock->priority = priority;
+	pheap_update(&holder->held_locks, &lock->holder_elem);
+	thread_update_priority(holder, effective_priority(holder));
+}
+
+/* Orders held locks by the priority they carry. */
+static bool
+held_lock_less (const struct pheap_elem *a, const struct pheap_elem *b,
+		void *aux UNUSED) {
+	return pheap_entry (a, struct lock, holder_elem)->priority
+		< pheap_entry (b, struct lock, holder_elem)->priority;
 }
 
 /* MLFQS */
-void mlfqs_priority(struct thread *t) {
-	if (t == idle_thread) {
-		return;
-	}
+static int mlfqs_calc_priority(const struct thread *t) {
 	int new_priority = fp_to_int(sub_fp(int_to_fp(PRI_MAX), add_mixed(div_mixed(t->recent_cpu, 4), 2 * t->nice)));
 	if (new_priority > PRI_MAX) {
 		new_priority = PRI_MAX;
 	} else if (new_priority < PRI_MIN) {
 		new_priority = PRI_MIN;
 	}
-	t->priority = new_priority;
+	return new_priority;
 }
 
-void mlfqs_recent_cpu(struct thread *t) {
+void mlfqs_priority(struct thread *t) {
 	if (t == idle_thread) {
 		return;
 	}
-	int temp = div_fp(mult_mixed(load_avg, 2), add_mixed(mult_mixed(load_avg, 2), 1));
-	t->recent_cpu = add_mixed(mult_fp(temp, t->recent_cpu), t->nice);
+	thread_update_priority(t, mlfqs_calc_priority(t));
 }
 
-void mlfqs_load_avg() {
-	int ready_list_size = list_size(&ready_list);
-	if (thread_current() != idle_thread){
-		ready_list_size += 1;
+/* Returns RECENT_CPU after one decay with load average LA for
+   a thread whose nice value is NICE. */
+static int
+decay_recent_cpu(int recent_cpu, int nice, int la) {
+	int coef = div_fp(mult_mixed(la, 2), add_mixed(mult_mixed(la, 2), 1));
+	return add_mixed(mult_fp(coef, recent_cpu), nice);
+}
+
+/* Returns RECENT_CPU after CNT decays, all with load average LA,
+   for a thread whose nice value is NICE.  With c = 2*la/(2*la+1)
+   the recurrence r' = c*r + nice has the closed form
+   c^n*r + nice*(1 - c^n)*(2*la + 1). */
+static int
+decay_recent_cpu_n(int recent_cpu, int nice, int la, int64_t cnt) {
+	int coef = div_fp(mult_mixed(la, 2), add_mixed(mult_mixed(la, 2), 1));
+	int coef_n = int_to_fp(1);
+
+	for (; cnt > 0; cnt >>= 1) {
+		if (cnt & 1)
+			coef_n = mult_fp(coef_n, coef);
+		coef = mult_fp(coef, coef);
 	}
+	return add_fp(mult_fp(coef_n, recent_cpu),
+			mult_fp(mult_mixed(sub_fp(int_to_fp(1), coef_n), nice),
+				add_mixed(mult_mixed(la, 2), 1)));
+}
+
+/* Applies the recent_cpu decays T has missed since it was last
+   inspected.  The caller recomputes T's priority. */
+static void
+mlfqs_catch_up(struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t == idle_thread || t->decay_epoch == decay_epoch)
+		return;
+
+	if (decay_epoch - t->decay_epoch > DECAY_HISTORY) {
+		/* The load average of these decays is no longer known;
+		   use the oldest one recorded. */
+		int64_t old = decay_epoch - t->decay_epoch - DECAY_HISTORY;
+		int la = decay_load_avg[(decay_epoch + 1) % DECAY_HISTORY];
+		t->recent_cpu = decay_recent_cpu_n(t->recent_cpu, t->nice, la, old);
+		t->decay_epoch += old;
+	}
+	while (t->decay_epoch < decay_epoch) {
+		t->decay_epoch++;
+		t->recent_cpu = decay_recent_cpu(t->recent_cpu, t->nice,
+				decay_load_avg[t->decay_epoch % DECAY_HISTORY]);
+	}
+}
+
+void mlfqs_load_avg() {
+	int ready_list_size = ready_threads ();
 	load_avg =  add_fp (mult_fp (div_fp (int_to_fp (59), int_to_fp (60)), load_avg), mult_mixed (div_fp (int_to_fp (1), int_to_fp (60)), ready_list_size));
 }
 
+/* Recomputes the priority of the running thread.  Within a
+   4-tick window only the running thread accumulates recent_cpu,
+   so no other thread's priority can have changed.  The running
+   thread may have been picked before decay_work caught it up, so
+   it is caught up here first. */
 void mlfqs_recalculate_priority() {
 	enum intr_level old_level = intr_disable();
-	for (struct list_elem *e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		if (t == idle_thread) {
-			continue;
-		}
-		mlfqs_priority(t);
+	struct thread *curr = running_thread();
+	if (curr != idle_thread) {
+		mlfqs_catch_up(curr);
+		mlfqs_priority(curr);
 	}
 	intr_set_level(old_level);
 }
 
+/* Starts a new decay epoch.  The running thread is caught up at
+   once, and the ready threads by decay_work, since their
+   priorities decide who runs next; blocked threads catch up when
+   they are unblocked. */
 void mlfqs_recalculate_recent_cpu() {
 	enum intr_level old_level = intr_disable();
-	for (struct list_elem *e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-		struct thread *t = list_entry(e, struct thread, all_elem);
-		if (t == idle_thread) {
-			continue;
+	decay_epoch++;
+	decay_load_avg[decay_epoch % DECAY_HISTORY] = load_avg;
+
+	mlfqs_catch_up(running_thread());
+	mlfqs_priority(running_thread());
+	work_schedule(&decay_work);
+	intr_set_level(old_level);
+}
+
+/* Catches up the ready threads with the latest decay, turning
+   interrupts off for one run queue at a time rather than for all
+   of them.  Runs on the highest-priority worker, but under the
+   MLFQS that worker's priority is computed like any other's, so
+   ready threads at or above it may still run first, picked by
+   priorities one decay out of date.  Such a thread is caught up
+   by mlfqs_recalculate_priority() within 4 ticks. */
+static void
+mlfqs_decay_ready(void *aux UNUSED) {
+	for (int pri = PRI_MAX; pri >= PRI_MIN; pri--) {
+		enum intr_level old_level = intr_disable();
+
+		/* Catching up moves threads between queues, so
+		   collect them first.  A thread moved to a queue not
+		   yet visited is already caught up there. */
+		struct list stale;
+		list_init(&stale);
+		while (!list_empty(&ready_queues[pri])) {
+			struct thread *t = list_entry(list_front(&ready_queues[pri]), struct thread, elem);
+			ready_remove(t);
+			list_push_back(&stale, &t->elem);
+		}
+		while (!list_empty(&stale)) {
+			struct thread *t = list_entry(list_pop_front(&stale), struct thread, elem);
+			mlfqs_catch_up(t);
+			t->priority = mlfqs_calc_priority(t);
+			ready_push(t);
 		}
-		mlfqs_recent_cpu(t);
+		intr_set_level(old_level);
 	}
-	intr_set_level(old_level);
 }
 
 void mlfqs_incr(){
-	struct thread *t = thread_current();
+	struct thread *t = running_thread ();
 	if (t == idle_thread){
 		return;
 	}
@@ -827,6 +1499,152 @@ void mlfqs_incr(){
 	t->recent_cpu = add_mixed(curr_recent_cpu,1);
 }
 
+/* Returns T's CFS weight, from its nice value. */
+static int
+cfs_weight (const struct thread *t) {
+	int nice = t->nice < -20 ? -20 : t->nice > 20 ? 20 : t->nice;
+	return cfs_nice_weight[nice + 20];
+}
+
+/* Advances min_vruntime to the least vruntime among the
+   running and ready threads, if that is greater.  Never moving it
+   back keeps waking and new threads from being placed behind
+   vruntime that has already been handed out. */
+static void
+cfs_update_min_vruntime (void) {
+	struct thread *curr = running_thread ();
+	int64_t min = INT64_MAX;
+
+	if (curr != idle_thread && curr->status == THREAD_RUNNING)
+		min = curr->vruntime;
+	if (!rb_empty (&cfs_tree)) {
+		struct thread *t = rb_entry (rb_min (&cfs_tree), struct thread,
+				cfs_elem);
+		if (t->vruntime < min)
+			min = t->vruntime;
+	}
+	if (min != INT64_MAX && min > min_vruntime)
+		min_vruntime = min;
+}
+
+/* Returns the number of ticks running thread T may run before it
+   is preempted: its weighted share of the target latency, which
+   is stretched so no slice falls below the minimum granularity. */
+static unsigned
+cfs_slice (const struct thread *t) {
+	int64_t period = CFS_LATENCY;
+	int64_t weight = cfs_weight (t);
+	int64_t slice;
+
+	if ((int64_t) (ready_cnt + 1) * CFS_MIN_GRANULARITY > period)
+		period = (ready_cnt + 1) * CFS_MIN_GRANULARITY;
+	slice = period * weight / (cfs_total_weight + weight);
+	return slice < CFS_MIN_GRANULARITY ? CFS_MIN_GRANULARITY : slice;
+}
+
+/* Returns true if the leftmost ready thread is far enough behind
+   the running thread that it should preempt it. */
+static bool
+cfs_should_preempt (void) {
+	struct thread *curr = running_thread ();
+	struct thread *next = rb_entry (rb_min (&cfs_tree), struct thread,
+			cfs_elem);
+
+	return curr == idle_thread
+		|| next->vruntime + CFS_WAKEUP_GRANULARITY < curr->vruntime;
+}
+
+/* Orders the CFS run queue by vruntime.  Ties keep FIFO order. */
+static bool
+cfs_less (const struct rb_elem *a, const struct rb_elem *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct thread, cfs_elem)->vruntime
+		< rb_entry (b, struct thread, cfs_elem)->vruntime;
+}
+
+/* Returns true if T is a real-time thread with budget left. */
+static bool
+rt_active (const struct thread *t) {
+	return t->rt_period != 0 && !t->rt_throttled;
+}
+
+/* Returns true if a real-time thread in the EDF queue should run
+   instead of T. */
+static bool
+rt_preempts (const struct thread *t) {
+	const struct thread *first;
+
+	if (rb_empty (&rt_tree))
+		return false;
+	first = rb_entry (rb_min (&rt_tree), struct thread, rt_elem);
+	return !rt_active (t) || first->rt_deadline < t->rt_deadline;
+}
+
+/* Charges a tick to the running thread CURR if it is real-time,
+   throttling it if that uses up its budget, then starts the next
+   period of every real-time thread whose deadline has arrived.
+   A thread that reaches its deadline still wanting to run, with
+   budget left, has missed it.  Returns true if CURR should now
+   yield.  Interrupts must be off. */
+static bool
+rt_tick (struct thread *curr) {
+	int64_t now = timer_ticks ();
+	bool preempt = false;
+	struct list_elem *e;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (rt_active (curr) && --curr->rt_budget <= 0) {
+		curr->rt_throttled = true;
+		preempt = true;
+	}
+
+	for (e = list_begin (&rt_threads); e != list_end (&rt_threads);
+			e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, rt_allelem);
+		bool queued = t->status == THREAD_READY;
+
+		if (now < t->rt_deadline)
+			continue;
+		if (t->status != THREAD_BLOCKED && !t->rt_throttled && t->rt_budget > 0)
+			rt_misses++;
+		rt_periods++;
+
+		/* Its queue or its place in it changes. */
+		if (queued)
+			ready_remove (t);
+		t->rt_deadline += t->rt_period;
+		if (t->rt_deadline <= now)
+			t->rt_deadline = now + t->rt_period;
+		t->rt_budget = t->rt_runtime;
+		t->rt_throttled = false;
+		if (queued)
+			ready_push (t);
+	}
+	return preempt || rt_preempts (curr);
+}
+
+/* Removes T from the real-time class, returning its bandwidth.
+   T must not be in a run queue.  Interrupts must be off. */
+static void
+rt_leave (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (t->status != THREAD_READY);
+
+	rt_bandwidth -= (t->rt_runtime << RT_BW_SHIFT) / t->rt_period;
+	list_remove (&t->rt_allelem);
+	t->rt_runtime = t->rt_period = 0;
+	t->rt_throttled = false;
+}
+
+/* Orders the EDF run queue by deadline.  Ties keep FIFO order. */
+static bool
+rt_less (const struct rb_elem *a, const struct rb_elem *b,
+		void *aux UNUSED) {
+	return rb_entry (a, struct thread, rt_elem)->rt_deadline
+		< rb_entry (b, struct thread, rt_elem)->rt_deadline;
+}
+
 struct thread *get_thread_by_tid(tid_t tid) {
 	struct thread *parent = thread_current();
 	struct list *child_list = &parent->children;
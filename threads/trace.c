@@ -0,0 +1,129 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+#ifdef SCHED_TRACE
+
+/* Number of pages in the trace buffer. */
+#define TRACE_PAGES 16
+
+/* Number of records in the trace buffer. */
+#define TRACE_CNT (TRACE_PAGES * PGSIZE / sizeof (struct trace_record))
+
+/* -trace: Record scheduler events? */
+bool trace_enabled;
+
+/* Ring buffer of TRACE_CNT records.  TRACE_HEAD counts every
+   record ever logged, so the oldest surviving one is at
+   TRACE_HEAD - TRACE_CNT once the buffer has wrapped. */
+static struct trace_record *trace_buf;
+static uint64_t trace_head;
+
+/* Time-stamp counter and timer ticks at trace_init(), to work out
+   the counter's frequency when dumping. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static const char *type_names[] = {
+	[TRACE_SWITCH] = "switch",
+	[TRACE_WAKEUP] = "wakeup",
+	[TRACE_DONATE] = "donate",
+	[TRACE_SLEEP] = "sleep",
+	[TRACE_TIMER_WAKE] = "timer-wake",
+	[TRACE_LOCK_WAIT] = "lock-wait",
+	[TRACE_LOCK_ACQUIRE] = "lock-acquire",
+	[TRACE_NAME] = "name",
+};
+
+/* Allocates the trace buffer, if tracing was turned on. */
+void
+trace_init (void) {
+	if (!trace_enabled)
+		return;
+
+	trace_buf = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, TRACE_PAGES);
+	start_tsc = rdtsc ();
+	start_ticks = timer_ticks ();
+	trace_name (thread_tid (), thread_name ());
+}
+
+/* Claims the next slot in the ring buffer.  Safe against
+   interrupt handlers logging in the middle of it. */
+static struct trace_record *
+trace_claim (uint16_t type, int tid) {
+	uint64_t idx = __atomic_fetch_add (&trace_head, 1, __ATOMIC_RELAXED);
+	struct trace_record *r = &trace_buf[idx % TRACE_CNT];
+
+	r->tsc = rdtsc ();
+	r->type = type;
+	/* Only the bootstrap processor runs threads for now. */
+	r->cpu = 0;
+	r->tid = tid;
+	return r;
+}
+
+/* Logs an event of TYPE about thread TID.  Use TRACE() instead,
+   which skips the call when tracing is off. */
+void
+trace_log (enum trace_type type, int tid, int arg, int64_t data) {
+	struct trace_record *r = trace_claim (type, tid);
+
+	r->arg = arg;
+	r->pad = 0;
+	r->data = data;
+}
+
+/* Logs that thread TID is named NAME, so that the dump can
+   label threads. */
+void
+trace_name (int tid, const char *name) {
+	struct trace_record *r = trace_claim (TRACE_NAME, tid);
+
+	strlcpy (r->name, name, sizeof r->name);
+}
+
+/* Prints the trace buffer, oldest record first, one record per
+   line between SCHEDTRACE BEGIN and END markers.  Logging is
+   paused meanwhile. */
+void
+trace_dump (void) {
+	uint64_t head, first, i;
+	uint64_t tsc_hz = 0;
+	int64_t ticks;
+
+	if (trace_buf == NULL)
+		return;
+
+	trace_enabled = false;
+	head = trace_head;
+	first = head > TRACE_CNT ? head - TRACE_CNT : 0;
+
+	ticks = timer_ticks () - start_ticks;
+	if (ticks > 0)
+		tsc_hz = (rdtsc () - start_tsc) / ticks * TIMER_FREQ;
+
+	printf ("SCHEDTRACE BEGIN tsc_hz=%"PRIu64" records=%"PRIu64
+			" dropped=%"PRIu64"\n", tsc_hz, head - first, first);
+	for (i = first; i < head; i++) {
+		struct trace_record *r = &trace_buf[i % TRACE_CNT];
+
+		printf ("%"PRIu64" %u %s %d ", r->tsc, r->cpu,
+				type_names[r->type], r->tid);
+		if (r->type == TRACE_NAME)
+			printf ("%s\n", r->name);
+		else
+			printf ("%d %"PRId64"\n", r->arg, r->data);
+	}
+	printf ("SCHEDTRACE END\n");
+	trace_enabled = true;
+}
+
+#endif /* SCHED_TRACE */
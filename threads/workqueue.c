@@ -0,0 +1,163 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "intrinsic.h"
+
+/* -no-defer: Run deferred work inline? */
+bool work_inline;
+
+/* A work queue, served by one worker thread.
+
+   Scheduled items are pushed onto a lock-free stack.  The worker
+   takes the whole stack at once and runs it oldest first.  Only
+   a push onto an empty stack ups READY, so each down of READY
+   finds a nonempty stack, and a burst of interrupts costs the
+   worker one wakeup. */
+struct workqueue {
+	const char *name;           /* Worker thread's name. */
+	int priority;               /* Worker thread's priority... */
+	int nice;                   /* ...or nice value, under MLFQS/CFS. */
+	struct work *head;          /* Most recently scheduled item. */
+	struct semaphore ready;     /* Upped when HEAD becomes nonempty. */
+
+	/* Statistics. */
+	long long runs;             /* # of items run. */
+	long long batches;          /* # of times the worker woke. */
+	uint64_t delay_max;         /* Longest cycles from schedule to run. */
+};
+
+static struct workqueue queues[WORK_PRIO_CNT] = {
+	[WORK_HIGH] = { "work-high", PRI_MAX, -20 },
+	[WORK_DEFAULT] = { "work-default", PRI_MAX - 1, -10 },
+	[WORK_LOW] = { "work-low", PRI_DEFAULT, 0 },
+};
+
+static thread_func worker;
+
+/* Initializes the work queues.  Work may be scheduled from then
+   on, but does not run until workqueue_start(). */
+void
+workqueue_init (void) {
+	int i;
+
+	for (i = 0; i < WORK_PRIO_CNT; i++)
+		sema_init (&queues[i].ready, 0);
+}
+
+/* Starts the worker threads.  Must be called after
+   thread_start(). */
+void
+workqueue_start (void) {
+	int i;
+
+	for (i = 0; i < WORK_PRIO_CNT; i++) {
+		struct workqueue *q = &queues[i];
+		if (thread_create (q->name, q->priority, worker, q) == TID_ERROR)
+			PANIC ("cannot start %s", q->name);
+	}
+}
+
+/* Initializes W to run FUNC(AUX) on the worker of priority
+   PRIO. */
+void
+work_init (struct work *w, work_func *func, void *aux,
+		enum work_prio prio) {
+	ASSERT (w != NULL);
+	ASSERT (func != NULL);
+	ASSERT (prio < WORK_PRIO_CNT);
+
+	w->func = func;
+	w->aux = aux;
+	w->prio = prio;
+	w->pending = false;
+	w->next = NULL;
+}
+
+/* Schedules W to run on its worker.  Returns true if W was
+   queued, false if it was already pending.  May be called from
+   interrupt context. */
+bool
+work_schedule (struct work *w) {
+	struct workqueue *q = &queues[w->prio];
+	struct work *head;
+
+	if (__atomic_exchange_n (&w->pending, true, __ATOMIC_ACQ_REL))
+		return false;
+
+	if (work_inline) {
+		w->pending = false;
+		w->func (w->aux);
+		return true;
+	}
+
+	w->queued_tsc = rdtsc ();
+	head = __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+	do
+		w->next = head;
+	while (!__atomic_compare_exchange_n (&q->head, &head, w, true,
+				__ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	if (head == NULL)
+		sema_up (&q->ready);
+	return true;
+}
+
+/* Worker thread: runs the items scheduled on work queue Q_. */
+static void
+worker (void *q_) {
+	struct workqueue *q = q_;
+
+	if (thread_mlfqs || thread_cfs)
+		thread_set_nice (q->nice);
+
+	for (;;) {
+		struct work *w, *batch = NULL;
+
+		sema_down (&q->ready);
+		q->batches++;
+
+		/* Take the whole stack and reverse it into the order the
+		   items were scheduled. */
+		w = __atomic_exchange_n (&q->head, NULL, __ATOMIC_ACQUIRE);
+		while (w != NULL) {
+			struct work *next = w->next;
+			w->next = batch;
+			batch = w;
+			w = next;
+		}
+
+		while (batch != NULL) {
+			uint64_t delay;
+
+			w = batch;
+			batch = w->next;
+			delay = rdtsc () - w->queued_tsc;
+			if (delay > q->delay_max)
+				q->delay_max = delay;
+			q->runs++;
+
+			/* Clear PENDING first, so that W can be scheduled
+			   again while it runs. */
+			__atomic_store_n (&w->pending, false, __ATOMIC_RELEASE);
+			w->func (w->aux);
+		}
+	}
+}
+
+/* Prints work queue statistics. */
+void
+workqueue_print_stats (void) {
+	int i;
+
+	if (work_inline)
+		return;
+	for (i = 0; i < WORK_PRIO_CNT; i++) {
+		const struct workqueue *q = &queues[i];
+		printf ("Work: %s ran %lld items in %lld batches, "
+				"max delay %"PRIu64" cycles\n",
+				q->name, q->runs, q->batches, q->delay_max);
+	}
+}
@@ -13,6 +13,7 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
@@ -200,7 +201,9 @@ __do_fork (void *aux) {
 	 * TODO:       in include/filesys/file.h. Note that parent should not return
 	 * TODO:       from the fork() until this function successfully duplicates
 	 * TODO:       the resources of parent.*/
-	for (int i=3; i<FD_MAX; i++) {
+	if (!fd_table_reserve(curr, parent->fd_cap))
+		goto error;
+	for (int i=3; i<parent->fd_cap; i++) {
 		if (parent->fd_table[i] != NULL){
 			curr->fd_table[i] = file_duplicate(parent->fd_table[i]);
 		}
@@ -212,6 +215,8 @@ __do_fork (void *aux) {
 	if (succ)
 		do_iret (&if_);
 error:
+	/* The parent checks process_status as soon as it wakes. */
+	curr->process_status = PROCESS_ERR;
 	sema_up(&curr->fork_sema);
 	exit (-1);
 }
@@ -275,6 +280,10 @@ process_wait (tid_t child_tid UNUSED) {
 	}
 	sema_down(&child->wait_sema);
 	int child_status = child->process_status;
+	if (thread_current ()->usage != NULL && child->usage != NULL) {
+		thread_rusage_add (&thread_current ()->usage->children, &child->usage->self);
+		thread_rusage_add (&thread_current ()->usage->children, &child->usage->children);
+	}
 
 	list_remove(&child->child_elem);
 	sema_up(&child->free_sema);
@@ -291,14 +300,16 @@ process_exit (void) {
 	 * TODO: project2/process_termination.html).
 	 * TODO: We recommend you to implement process resource cleanup here. */
 
-	for (int i = 3; i <= FD_MAX; i++) {		//(oom_update)
+	for (int i = 3; i < curr->fd_cap; i++) {		//(oom_update)
 		close(i);
 	}
-	palloc_free_multiple(curr->fd_table, FD_PAGES);
+	free(curr->fd_table);
+	curr->fd_table = NULL;
+	curr->fd_cap = 0;
 	file_close(curr->running); 
 	process_cleanup();
 
-	sema_up(&curr->wait_sema); // 끝나고 기다리는 부모한테 세마포 넘겨줌
+	sema_up_and_yield_to(&curr->wait_sema); // 끝나고 기다리는 부모한테 세마포 넘겨줌
 	sema_down(&curr->free_sema); // 부모가 자식 free하고 세마포 넘길 때까지 기다림
 }
 
@@ -333,10 +344,21 @@ process_cleanup (void) {
  * This function is called on every context switch. */
 void
 process_activate (struct thread *next) {
-	/* Activate thread's page tables. */
-	pml4_activate (next->pml4);
-
-	/* Set thread's kernel stack for use in processing interrupts. */
+	/* A kernel thread never touches user memory, so it keeps
+	 * whichever page tables are active: all of them map the kernel
+	 * alike.  A process's own page tables are destroyed only while
+	 * it runs, after it has switched to the kernel-only ones, so
+	 * the tables it borrows cannot go away under it. */
+	if (next->pml4 == NULL)
+		return;
+
+	/* Activate thread's page tables, unless they already are, since
+	 * reloading CR3 flushes the TLB. */
+	if (rcr3 () != vtop (next->pml4))
+		pml4_activate (next->pml4);
+
+	/* Set thread's kernel stack for use in processing interrupts.
+	 * Only user code enters the kernel on the TSS's stack. */
 	tss_update (next);
 }
 
@@ -12,6 +12,8 @@
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
 
 #include "threads/synch.h"
 #include <string.h>
@@ -77,6 +79,7 @@ syscall_init (void) {
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 
 	lock_init(&syscall_lock);
+	lock_set_name(&syscall_lock, "syscall");
 }
 
 /* The main system call interface */
@@ -142,6 +145,14 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_CLOSE:							//  13 파일 닫기
 			close(arg1);
 			break;
+		case SYS_GETRUSAGE:						//  자원 사용량 조회
+			check_valid_buffer((void *)arg2, sizeof (struct rusage), true);
+			f->R.rax=getrusage(arg1,(struct rusage *)arg2);
+			break;
+		case SYS_CLOCK_GETTIME:					//  시각 조회 (ns)
+			check_valid_buffer((void *)arg2, sizeof (struct timespec), true);
+			f->R.rax=clock_gettime(arg1,(struct timespec *)arg2);
+			break;
 		default:
 			break;
 	}
@@ -180,6 +191,38 @@ int wait (pid_t pid){
 	return process_wait(pid);
 }
 
+int getrusage (int who, struct rusage *usage){
+	struct thread *curr = thread_current();
+	struct rusage copy;
+
+	/* Snapshot with interrupts off, since the timer interrupt and
+	   the scheduler update our usage; then copy out, which may
+	   fault. */
+	if (who != RUSAGE_SELF && who != RUSAGE_CHILDREN)
+		return -1;
+	enum intr_level old_level = intr_disable();
+	if (curr->usage == NULL)
+		memset(&copy, 0, sizeof copy);
+	else if (who == RUSAGE_SELF)
+		copy = curr->usage->self;
+	else
+		copy = curr->usage->children;
+	intr_set_level(old_level);
+
+	*usage = copy;
+	return 0;
+}
+
+int clock_gettime (clockid_t clock, struct timespec *tp){
+	if (clock != CLOCK_MONOTONIC)
+		return -1;
+
+	int64_t ns = timer_ns();
+	tp->tv_sec = ns / NSEC_PER_SEC;
+	tp->tv_nsec = ns % NSEC_PER_SEC;
+	return 0;
+}
+
 bool create (const char *file, unsigned initial_size){
 	lock_acquire(&syscall_lock);		
 	bool create_return = filesys_create(file, initial_size);
@@ -203,18 +246,17 @@ int open (const char *file) {	//(oom_update)
 		return -1;
 	}
 	struct thread *curr = thread_current();
-	struct file **fdt = curr->fd_table;
 
-	while (curr->next_fd < FD_MAX && fdt[curr->next_fd])
+	while (curr->next_fd < curr->fd_cap && curr->fd_table[curr->next_fd])
 		curr->next_fd++;
 
-	if (curr->next_fd >= FD_MAX) {
+	if (curr->next_fd >= FD_MAX || !fd_table_reserve (curr, curr->next_fd + 1)) {
 		file_close (f);
 		lock_release(&syscall_lock);
 		return -1;
 	}
 
-	fdt[curr->next_fd] = f;
+	curr->fd_table[curr->next_fd] = f;
 	lock_release(&syscall_lock);
 	return curr->next_fd;
 }
@@ -310,9 +352,9 @@ unsigned tell (int fd){
 }
 
 void close (int fd){	//(oom_update)
-	if (fd <= 2)
-		return;
 	struct thread *curr = thread_current ();
+	if (fd <= 2 || fd >= curr->fd_cap)
+		return;
 	struct file *f = curr->fd_table[fd];
 
 	if (f == NULL){
@@ -352,8 +394,38 @@ void check_valid_buffer(void *buffer, size_t size UNUSED, bool writable UNUSED){
 }
 
 struct file *get_file_by_descriptor(int fd){
-	if (fd < 3 || fd > 128)
-		return NULL;
 	struct thread *t = thread_current();
+	if (fd < 3 || fd >= t->fd_cap)
+		return NULL;
 	return t->fd_table[fd];
+}
+
+/* Makes T's fd table hold at least CNT descriptors, which must
+   not exceed FD_MAX.  The table is allocated on the first open
+   and doubles in size as needed, so threads that never open a
+   file never pay for one.  Returns false if out of memory. */
+bool fd_table_reserve(struct thread *t, int cnt) {
+	struct file **fdt;
+	int cap;
+
+	ASSERT (cnt <= FD_MAX);
+	if (cnt <= t->fd_cap)
+		return true;
+
+	cap = t->fd_cap > 0 ? t->fd_cap : FD_TABLE_MIN;
+	while (cap < cnt)
+		cap *= 2;
+	if (cap > FD_MAX)
+		cap = FD_MAX;
+
+	fdt = calloc(cap, sizeof *fdt);
+	if (fdt == NULL)
+		return false;
+	if (t->fd_table != NULL) {
+		memcpy(fdt, t->fd_table, t->fd_cap * sizeof *fdt);
+		free(t->fd_table);
+	}
+	t->fd_table = fdt;
+	t->fd_cap = cap;
+	return true;
 }
\ No newline at end of file
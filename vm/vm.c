@@ -1,6 +1,7 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 #include "threads/mmu.h"
@@ -8,6 +9,11 @@
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 struct frame_table global_ft;
+
+/* Caches of struct page and struct frame. */
+static struct kmem_cache page_cache;
+static struct kmem_cache frame_cache;
+
 void
 vm_init (void) {
 	vm_anon_init ();
@@ -19,6 +25,8 @@ vm_init (void) {
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. 👻 */
 	list_init(&global_ft.frame_list);
+	kmem_cache_init (&page_cache, "struct page", sizeof (struct page), NULL);
+	kmem_cache_init (&frame_cache, "struct frame", sizeof (struct frame), NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -60,7 +68,9 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		/* TODO: Create the page, fetch the initialier according to the VM type,
 		 * TODO: and then create "uninit" page struct by calling uninit_new. You
 		 * TODO: should modify the field after calling the uninit_new. */
-		struct page *page = (struct page *)malloc(sizeof(struct page));
+		struct page *page = kmem_cache_alloc (&page_cache);
+		if (page == NULL)
+			goto err;
 		vm_initializer *initializer = NULL;
 		switch (VM_TYPE(type))
 		{
@@ -79,7 +89,7 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 		/* TODO: Insert the page into the spt. */
 		if(!spt_insert_page(spt, page)){
-			free(page);
+			kmem_cache_free (&page_cache, page);
 			goto err;
 		}
 		
@@ -188,7 +198,7 @@ vm_get_frame (void) {
 		// kva = f->kva;
 		PANIC("evict");
 	}
-	struct frame *frame = malloc(sizeof(struct frame));
+	struct frame *frame = kmem_cache_alloc (&frame_cache);
 	ASSERT (frame != NULL);
 	
 	frame->kva = kva;
@@ -263,7 +273,7 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 void
 vm_dealloc_page (struct page *page) {
 	destroy (page);
-	free (page);
+	kmem_cache_free (&page_cache, page);
 }
 
 /* Claim the page that allocate on VA. 👻 */